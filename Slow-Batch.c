@@ -0,0 +1,222 @@
+#include "Slow-Batch.h"
+
+#include "Slow-Lanes.h"
+
+#include <string.h>
+
+// games in the lanes. the player to move is always slot step % 2, so the
+// fields of the mover are read without selecting per lane.
+typedef struct {
+    lanes hands[2][k_number_of_ranks+1];    // counts of each rank.
+    lanes mask[2];                          // bits of the ranks in hands, as hands_mask.
+    lanes number_of_hands[2];
+    lanes deck_top[2];
+    lanes sum[2];
+    lanes passed[2];                        // the previous action of the slot was a pass.
+    lanes top_left;
+    lanes top_right;
+    lanes number_of_turns;
+    lanes active;                           // the lane has a game.
+    lanes64 random;
+    uint8_t deck[2][k_number_of_deck][SLOW_LANES];
+    int32_t index_of_game[SLOW_LANES];
+    int32_t slot_p1[SLOW_LANES];
+} batch_block;
+
+int32_t batch_number_of_lanes( void )
+{
+    return SLOW_LANES;
+}
+
+// the n-th card of hands in ascending order, counting copies.
+static lanes lanes_hands_nth( const lanes *hands, const lanes n )
+{
+    lanes count = {0};
+    lanes card = count + 1;
+    for ( int32_t rank = 1; rank < k_number_of_ranks; rank++ ) {
+        count += hands[rank];
+        card -= LANES_IF( count <= n );
+    }
+    return card;
+}
+
+static void batch_load( batch_block *block, const int32_t l, const int32_t mover, const int32_t index_of_game, const int16_t *decks, const uint64_t policy_seed )
+{
+    const int16_t *deck_p1 = decks;
+    const int16_t *deck_p2 = decks + k_number_of_deck;
+
+    // the first player moves in this step.
+    const int32_t slot_p1 = mover ^ ( index_of_game % 2 );
+    for ( int32_t slot = 0; slot < 2; slot++ ) {
+        const int16_t *deck = slot == slot_p1 ? deck_p1 : deck_p2;
+        uint32_t sum = 0;
+        for ( int32_t i = 0; i < k_number_of_deck; i++ ) {
+            block->deck[slot][i][l] = (uint8_t)deck[i];
+            sum += deck[i];
+        }
+        for ( int32_t rank = 0; rank <= k_number_of_ranks; rank++ ) {
+            LANE( block->hands[slot][rank], l ) = 0;
+        }
+        LANE( block->mask[slot], l ) = 0;
+        LANE( block->number_of_hands[slot], l ) = 0;
+        LANE( block->deck_top[slot], l ) = 0;
+        LANE( block->sum[slot], l ) = sum;
+        LANE( block->passed[slot], l ) = 0;
+    }
+    LANE( block->top_left, l ) = 0;
+    LANE( block->top_right, l ) = 0;
+    LANE( block->number_of_turns, l ) = 0;
+    LANE( block->active, l ) = UINT32_MAX;
+
+    game_random random;
+    game_random_seed_stream( &random, policy_seed, (uint64_t)index_of_game );
+    LANE( block->random, l ) = random.state;
+    block->index_of_game[l] = index_of_game;
+    block->slot_p1[l] = slot_p1;
+}
+
+static void batch_store( const batch_block *block, const int32_t l, batch_result *result )
+{
+    // the same as game_points.
+    const int32_t sum_p1 = (int32_t)LANE( block->sum[block->slot_p1[l]], l );
+    const int32_t sum_p2 = (int32_t)LANE( block->sum[block->slot_p1[l] ^ 1], l );
+    result->points_p1 = 0;
+    result->points_p2 = 0;
+    if ( sum_p1 == 0 ) {
+        result->points_p1 += sum_p2;
+        result->points_p2 -= sum_p2;
+    }
+    if ( sum_p2 == 0 ) {
+        result->points_p1 -= sum_p1;
+        result->points_p2 += sum_p1;
+    }
+    result->number_of_turns = (int32_t)LANE( block->number_of_turns, l );
+}
+
+// one turn of the mover in every active lane.
+static void batch_step( batch_block *block, const int32_t mover )
+{
+    lanes *hands = block->hands[mover];
+    const lanes active = block->active;
+    const lanes mask = block->mask[mover];
+    const lanes number_of_hands = block->number_of_hands[mover];
+    const lanes passed = block->passed[mover];
+    const lanes can_draw = LANES_IF( number_of_hands < k_max_hands ) & LANES_IF( block->deck_top[mover] < k_number_of_deck );
+    const lanes top_left = block->top_left;
+    const lanes top_right = block->top_right;
+
+    // the ranks next to the tops, as k_neighbor_ranks. an empty pile uses none.
+    const lanes upper_left = top_left + 1 - ( LANES_IF( top_left == k_number_of_ranks ) & k_number_of_ranks );
+    const lanes lower_left = top_left - 1 + ( LANES_IF( top_left <= 1 ) & k_number_of_ranks );
+    const lanes upper_right = top_right + 1 - ( LANES_IF( top_right == k_number_of_ranks ) & k_number_of_ranks );
+    const lanes lower_right = top_right - 1 + ( LANES_IF( top_right <= 1 ) & k_number_of_ranks );
+    const lanes has_upper_left = ( mask >> upper_left ) & 1;
+    const lanes has_lower_left = ( mask >> lower_left ) & 1;
+    const lanes has_upper_right = ( mask >> upper_right ) & 1;
+    const lanes has_lower_right = ( mask >> lower_right ) & 1;
+
+    // the numbers of the candidates, in the order of play_action_candidates_mask.
+    const lanes count_left = lanes_select( LANES_IF( top_left == 0 ), number_of_hands, has_upper_left + has_lower_left );
+    const lanes count_right = lanes_select( LANES_IF( top_right == 0 ), number_of_hands, has_upper_right + has_lower_right );
+    const lanes count_put = lanes_select( passed, number_of_hands * 2, count_left + count_right );
+    const lanes count = count_put + ( can_draw & 1 );
+
+    // the pass is chosen only when there is no other candidate.
+    const lanes is_pass = LANES_IF( count == 0 );
+    const lanes k = lanes_random_bounded( &block->random, count + ( is_pass & 1 ), active );
+    const lanes is_draw = active & ~is_pass & LANES_IF( k >= count_put );
+    const lanes is_put = active & ~is_pass & ~is_draw;
+
+    // after a pass the candidates alternate left and right for every card.
+    const lanes is_right = lanes_select( passed, LANES_IF( ( k & 1 ) != 0 ), LANES_IF( k >= count_left ) );
+    const lanes n = lanes_select( passed, k >> 1, k - ( count_left & is_right ) );
+    const lanes top = lanes_select( is_right, top_right, top_left );
+    const lanes upper = lanes_select( is_right, upper_right, upper_left );
+    const lanes lower = lanes_select( is_right, lower_right, lower_left );
+    const lanes has_upper = lanes_select( is_right, has_upper_right, has_upper_left );
+    const lanes neighbor = ~passed & LANES_IF( top != 0 );
+    const lanes card_neighbor = lanes_select( LANES_IF( n == 0 ) & LANES_IF( has_upper != 0 ), upper, lower );
+    const lanes card_put = lanes_select( neighbor, card_neighbor, lanes_hands_nth( hands, n ) );
+
+    // decks differ in every lane, so the drawn card is gathered.
+    lanes drawn = {0};
+    for ( int32_t l = 0; l < SLOW_LANES; l++ ) {
+        const uint32_t deck_top = LANE( block->deck_top[mover], l );
+        LANE( drawn, l ) = deck_top < k_number_of_deck ? block->deck[mover][deck_top][l] : 0;
+    }
+    const lanes card = lanes_select( is_draw, drawn, card_put );
+
+    lanes new_mask = {0};
+    for ( int32_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+        const lanes hit = LANES_IF( card == (uint32_t)rank );
+        hands[rank] = hands[rank] + ( hit & is_draw & 1 ) - ( hit & is_put & 1 );
+        new_mask |= LANES_IF( hands[rank] != 0 ) & ( 1u << rank );
+    }
+    block->mask[mover] = new_mask;
+    block->number_of_hands[mover] = number_of_hands + ( is_draw & 1 ) - ( is_put & 1 );
+    block->deck_top[mover] += is_draw & 1;
+    block->sum[mover] -= card & is_put;
+    block->passed[mover] = lanes_select( active, is_pass, passed );
+    block->top_left = lanes_select( is_put & ~is_right, card, top_left );
+    block->top_right = lanes_select( is_put & is_right, card, top_right );
+    block->number_of_turns += active & 1;
+}
+
+bool batch_simulate( batch_result *results, deal_source *deals, const uint64_t policy_seed, const int32_t index_of_game, const int32_t number_of_games )
+{
+    batch_block block;
+    memset( &block, 0, sizeof( block ) );
+
+    int32_t number_of_loaded = 0;
+    int32_t number_of_active = 0;
+    for ( int32_t l = 0; l < SLOW_LANES && number_of_loaded < number_of_games; l++ ) {
+        const int16_t *decks = deal_source_decks( deals, index_of_game + number_of_loaded );
+        if ( ! decks ) return false;
+        batch_load( &block, l, 0, index_of_game + number_of_loaded++, decks, policy_seed );
+        number_of_active++;
+    }
+
+    for ( int32_t step = 0; number_of_active > 0; step++ ) {
+        const int32_t mover = step % 2;
+        batch_step( &block, mover );
+
+        // only the sum of the mover changes.
+        const lanes ended = block.active & LANES_IF( block.sum[mover] == 0 );
+        if ( ! lanes_any( ended ) ) continue;
+        for ( int32_t l = 0; l < SLOW_LANES; l++ ) {
+            if ( ! LANE( ended, l ) ) continue;
+            batch_store( &block, l, &results[block.index_of_game[l] - index_of_game] );
+            if ( number_of_loaded < number_of_games ) {
+                const int16_t *decks = deal_source_decks( deals, index_of_game + number_of_loaded );
+                if ( ! decks ) return false;
+                batch_load( &block, l, 1 - mover, index_of_game + number_of_loaded++, decks, policy_seed );
+            } else {
+                LANE( block.active, l ) = 0;
+                number_of_active--;
+            }
+        }
+    }
+    return true;
+}
+
+bool batch_simulate_reference( batch_result *results, deal_source *deals, const uint64_t policy_seed, const int32_t index_of_game, const int32_t number_of_games )
+{
+    for ( int32_t i = 0; i < number_of_games; i++ ) {
+        const int16_t *decks = deal_source_decks( deals, index_of_game + i );
+        if ( ! decks ) return false;
+        game_state state;
+        game_init( &state, decks, decks + k_number_of_deck, ( index_of_game + i ) % 2 );
+        game_random random;
+        game_random_seed_stream( &random, policy_seed, (uint64_t)( index_of_game + i ) );
+
+        while ( ! game_is_end( &state ) ) {
+            play_action candidates[play_action_candidate_max];
+            int32_t count = game_legal_moves( &state, candidates );
+            if ( count > 1 && candidates[count-1].operation == play_operation_pass ) count--;
+            game_play( &state, candidates[game_random_bounded( &random, (uint32_t)count )] );
+        }
+        game_points( &state, &results[i].points_p1, &results[i].points_p2 );
+        results[i].number_of_turns = state.index_of_turn;
+    }
+    return true;
+}
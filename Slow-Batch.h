@@ -0,0 +1,54 @@
+#ifndef SLOW_BATCH_H
+#define SLOW_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Slow-Rule.h"
+#include "Slow-Deal.h"
+
+//!
+//! 多数の独立したゲームを同時に1ターンずつ進めるシミュレーターです.
+//!
+//! ゲームの状態は構造体の配列ではなく, 手札の番号ごとの枚数, 場の一番上の札, 山札の位置, パスしたかどうかを
+//! それぞれ複数のゲームの並びとして持ち, 候補の数, 乱数による行動の選択, 状態の更新をまとめて計算します.
+//! 1つの並びは 32 ビットの要素で, コンパイラのベクトル拡張で SSE2 や NEON では 4, AVX2 では 8, AVX-512 では 16 ゲームを1命令で進めます.
+//! ベクトル拡張が使えないコンパイラや SLOW_BATCH_SCALAR を定義した場合は1ゲームずつ同じ計算をします.
+//!
+//! 行動の選び方はサンプルプレイヤーと同じく, 候補からパスを除いて等しい確率で1つを選び, 候補がパスだけの場合はパスします.
+//! index_of_game 番目のゲームは deal_source_decks( deals, index_of_game ) の山札で index_of_game % 2 のプレイヤーから始め,
+//! game_random_seed_stream( random, policy_seed, index_of_game ) の乱数列で両方のプレイヤーの行動を選びます.
+//! 同じ引数の batch_simulate と batch_simulate_reference の結果は一致します.
+//!
+
+//! 1ゲームの結果
+typedef struct {
+    int32_t points_p1;
+    int32_t points_p2;
+    int32_t number_of_turns;    //!< 終了までのターンの数
+} batch_result;
+
+//! 1命令で進めるゲームの数. スカラーでは 1.
+int32_t batch_number_of_lanes( void );
+
+//!
+//! @brief  index_of_game 番目から number_of_games 個のゲームをまとめて最後まで進めます
+//!
+//! 終わったゲームの並びの位置には次のゲームを配るので, ゲームの長さが違っても位置は空きません.
+//! 山札は番号の順に deals から取るので, deals はまとめて配れます.
+//!
+//! @param  results [out]結果. number_of_games 以上の配列で, i 番目は index_of_game + i 番目のゲーム.
+//!
+//! @return deals から山札を取れなければ false
+//!
+bool batch_simulate( batch_result *results, deal_source *deals, const uint64_t policy_seed, const int32_t index_of_game, const int32_t number_of_games );
+
+//!
+//! @brief  batch_simulate と同じゲームを game_legal_moves と game_play で1ゲームずつ進めます
+//!
+//! batch_simulate の結果を確かめるためのもので, 速度の比較にも使います.
+//!
+bool batch_simulate_reference( batch_result *results, deal_source *deals, const uint64_t policy_seed, const int32_t index_of_game, const int32_t number_of_games );
+
+#endif
@@ -0,0 +1,582 @@
+//
+// benchmarks of the rules, the protocol and whole games.
+//
+// the server and the sample player are compiled into this file so their
+// encoders and parsers are measured as they are. every result is printed
+// as one JSON object per line.
+//
+// the server comes first for its _GNU_SOURCE.
+//
+#define SLOW_SERVER_NO_MAIN
+#define SLOW_PLAYER_PLUGIN
+#include "Slow-Server.c"
+#include "Slow-Player.c"
+#include "Slow-Batch.h"
+#include "Slow-Deal.h"
+
+// constants.
+static const int32_t k_bench_max_states = 4096;
+static const int32_t k_bench_deal_games = 1024;    // games dealt at once.
+
+// options.
+static int64_t bench_iterations = 1000000;
+static int32_t bench_games = 1000;
+static int32_t bench_simulations = 100000;
+static uint64_t bench_seed = 1;
+static const char *bench_player = "./Slow-Player";
+static const char *bench_replay = NULL;
+static bool bench_binary = false;
+
+// keeps results alive so loops are not removed.
+static volatile int64_t bench_sink = 0;
+
+void bench_usage()
+{
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "使い方\n" );
+    fprintf( stdout, "./Slow-Bench --player ./Slow-Player --games 1000\n" );
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "オプション\n" );
+    fprintf( stdout, " --iterations 各マイクロベンチマークの繰り返し回数.\n" );
+    fprintf( stdout, " --games 端から端までのベンチマークの対戦数. 0 で省略.\n" );
+    fprintf( stdout, " --simulations まとめて進めるシミュレーターのベンチマークの対戦数. 0 で省略.\n" );
+    fprintf( stdout, " --player 端から端までのベンチマークで対戦させるプレイヤーの実行ファイル.\n" );
+    fprintf( stdout, " --binary プレイヤーに --binary を与える.\n" );
+    fprintf( stdout, " --seed 局面と山札を作る乱数の種.\n" );
+    fprintf( stdout, " --replay 局面をこのリプレイファイルの対戦から取る. 省略するとランダムな対戦から取る.\n" );
+    fprintf( stdout, "\n" );
+}
+
+double bench_now( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void bench_report( const char *name, const int64_t iterations, const double seconds )
+{
+    fprintf( stdout, "{\"benchmark\":\"%s\",\"iterations\":%lld,\"seconds\":%.6f,\"ns_per_op\":%.2f}\n", name, (long long)iterations, seconds, seconds * 1e9 / iterations );
+}
+
+// states of the turns of games, each with the action that was played.
+typedef struct {
+    game_state *states;
+    play_action *actions;
+    int32_t number_of_states;
+} bench_states;
+
+void bench_states_add( bench_states *states, const game_state *state, const play_action action )
+{
+    if ( states->number_of_states < k_bench_max_states ) {
+        states->states[states->number_of_states] = *state;
+        states->actions[states->number_of_states] = action;
+        states->number_of_states++;
+    }
+}
+
+// plays random legal moves, the same way the sample player chooses.
+void bench_states_random( bench_states *states )
+{
+    game_random random;
+    game_random_seed( &random, bench_seed );
+    for ( int32_t index_of_game = 0; states->number_of_states < k_bench_max_states; index_of_game++ ) {
+        int16_t deck_p1[k_number_of_deck];
+        int16_t deck_p2[k_number_of_deck];
+        deck_deal( deck_p1, deck_p2, bench_seed, index_of_game );
+        game_state state;
+        game_init( &state, deck_p1, deck_p2, index_of_game % 2 );
+        while ( ! game_is_end( &state ) ) {
+            play_action candidates[play_action_candidate_max];
+            int32_t count = game_legal_moves( &state, candidates );
+            if ( count > 1 && candidates[count-1].operation == play_operation_pass ) count--;
+            const play_action action = candidates[game_random_bounded( &random, (uint32_t)count )];
+            bench_states_add( states, &state, action );
+            game_apply( &state, action );
+        }
+    }
+}
+
+// re-simulates the games of a replay file.
+bool bench_states_replay( bench_states *states, const char *filename )
+{
+    FILE *file = fopen( filename, "rb" );
+    if ( ! file ) {
+        fprintf( stderr, "error: %s を開けませんでした(%d).\n", filename, __LINE__ );
+        return false;
+    }
+    fseek( file, 0, SEEK_END );
+    const long size = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    uint8_t *data = malloc( size > 0 ? size : 1 );
+    const bool loaded = data && size > 0 && fread( data, 1, size, file ) == (size_t)size;
+    fclose( file );
+
+    record_header header;
+    if ( ! loaded || ! record_decode_header( data, size, &header ) ) {
+        fprintf( stderr, "error: %s はリプレイファイルではありません(%d).\n", filename, __LINE__ );
+        free( data );
+        return false;
+    }
+    for ( int32_t n = 0; n < header.number_of_games && states->number_of_states < k_bench_max_states; n++ ) {
+        record_game game;
+        if ( ! record_decode_game( data, size, &header, n, &game ) ) continue;
+        game_state state;
+        game_init( &state, game.deck_p1, game.deck_p2, game.first );
+        for ( int32_t i = 0; i < game.number_of_actions && ! game_is_end( &state ); i++ ) {
+            const play_action action = protocol_decode_action( game.actions[i] );
+            bench_states_add( states, &state, action );
+            game_apply( &state, action );
+        }
+    }
+    free( data );
+    return states->number_of_states > 0;
+}
+
+void bench_candidates( const bench_states *states )
+{
+    play_action candidates[play_action_candidate_max];
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        sum += game_legal_moves( &states->states[i % states->number_of_states], candidates );
+    }
+    bench_report( "play_action_candidates", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+}
+
+void bench_sequence( const bench_states *states )
+{
+    int16_t hands[k_max_hands+1];
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        const game_state *state = &states->states[i % states->number_of_states];
+        hands_sequence( &state->players[i & 1], hands );
+        sum += hands[0] + *place_sequence( &state->left ) + *place_sequence( &state->right );
+    }
+    bench_report( "hands_sequence+place_sequence", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+}
+
+void bench_shuffle( void )
+{
+    int16_t deck_p1[k_number_of_deck];
+    int16_t deck_p2[k_number_of_deck];
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        deck_deal( deck_p1, deck_p2, bench_seed, (int32_t)i );
+        sum += deck_p1[0] + deck_p2[0];
+    }
+    bench_report( "deck_deal", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+}
+
+// deals the games in bulk, and compares them with deck_deal.
+bool bench_deal( void )
+{
+    int16_t *decks = malloc( (size_t)k_bench_deal_games * 2 * k_number_of_deck * sizeof( int16_t ) );
+    if ( ! decks ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i += k_bench_deal_games ) {
+        const int32_t count = bench_iterations - i < k_bench_deal_games ? (int32_t)( bench_iterations - i ) : k_bench_deal_games;
+        deal_decks( decks, bench_seed, (int32_t)i, count );
+        sum += decks[0] + decks[k_number_of_deck];
+    }
+    bench_report( "deal_decks", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+
+    bool identical = true;
+    deal_decks( decks, bench_seed, 0, k_bench_deal_games );
+    for ( int32_t i = 0; identical && i < k_bench_deal_games; i++ ) {
+        int16_t deck_p1[k_number_of_deck];
+        int16_t deck_p2[k_number_of_deck];
+        deck_deal( deck_p1, deck_p2, bench_seed, i );
+        const int16_t *deck = decks + (size_t)i * 2 * k_number_of_deck;
+        identical = memcmp( deck, deck_p1, sizeof( deck_p1 ) ) == 0 && memcmp( deck + k_number_of_deck, deck_p2, sizeof( deck_p2 ) ) == 0;
+        if ( ! identical ) fprintf( stderr, "error: %d 番目のゲームの山札が deck_deal と一致しません(%d).\n", i, __LINE__ );
+    }
+    free( decks );
+    return identical;
+}
+
+// the arguments of play() for a state, as the sample player receives them.
+typedef struct {
+    card_t you_hands[k_max_hands+1];
+    card_t op_hands[k_max_hands+1];
+    card_t place_left[k_max_place+1];
+    card_t place_right[k_max_place+1];
+    action_t you_previous;
+    action_t op_previous;
+} bench_play_arguments;
+
+void bench_play_arguments_make( const game_state *state, bench_play_arguments *arguments )
+{
+    const int32_t you = game_turn_player( state );
+    hands_sequence( &state->players[you], arguments->you_hands );
+    hands_sequence( &state->players[1-you], arguments->op_hands );
+    memcpy( arguments->place_left, place_sequence( &state->left ), ( state->left.length + 1 ) * sizeof( card_t ) );
+    memcpy( arguments->place_right, place_sequence( &state->right ), ( state->right.length + 1 ) * sizeof( card_t ) );
+    arguments->you_previous = action_from_play_action( state->previous[you] );
+    arguments->op_previous = action_from_play_action( state->previous[1-you] );
+}
+
+void bench_player_play( const bench_states *states )
+{
+    bench_play_arguments *arguments = malloc( states->number_of_states * sizeof( bench_play_arguments ) );
+    if ( ! arguments ) return;
+    for ( int32_t i = 0; i < states->number_of_states; i++ ) {
+        bench_play_arguments_make( &states->states[i], &arguments[i] );
+    }
+
+    reset( 0 );
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        bench_play_arguments *it = &arguments[i % states->number_of_states];
+        sum += play( (int32_t)i, it->you_hands, it->op_hands, it->place_left, it->place_right, it->you_previous, it->op_previous ).card;
+    }
+    bench_report( "play", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+    free( arguments );
+}
+
+void bench_write_sequence( const bench_states *states )
+{
+    message_buffer *message = calloc( 1, sizeof( message_buffer ) );
+    if ( ! message ) return;
+    int16_t hands[k_max_hands+1];
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        const game_state *state = &states->states[i % states->number_of_states];
+        message_clear( message );
+        hands_sequence( &state->players[i & 1], hands );
+        write_sequence( message, hands );
+        write_sequence( message, place_sequence( &state->left ) );
+        sum += message->length;
+    }
+    bench_report( "write_sequence", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+    free( message );
+}
+
+// includes the write() of the message to /dev/null, as a PLAY to a player does.
+void bench_write_play( const bench_states *states, const bool binary )
+{
+    const int fd = open( "/dev/null", O_WRONLY );
+    message_buffer *message = calloc( 1, sizeof( message_buffer ) );
+    if ( fd == -1 || ! message ) {
+        if ( fd != -1 ) close( fd );
+        free( message );
+        return;
+    }
+    int16_t hands_p1[k_max_hands+1];
+    int16_t hands_p2[k_max_hands+1];
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        const game_state *state = &states->states[i % states->number_of_states];
+        hands_sequence( &state->players[0], hands_p1 );
+        hands_sequence( &state->players[1], hands_p2 );
+        if ( binary ) {
+            sum += write_frame_play( fd, message, state->index_of_turn, hands_p1, hands_p2, place_top( &state->left ), place_top( &state->right ), state->previous[0], state->previous[1] );
+        } else {
+            sum += write_play( fd, message, state->index_of_turn, hands_p1, hands_p2, place_sequence( &state->left ), place_sequence( &state->right ), state->previous[0], state->previous[1] );
+        }
+    }
+    bench_report( binary ? "write_frame_play" : "write_play", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+    close( fd );
+    free( message );
+}
+
+void bench_read_play( const bench_states *states )
+{
+    // fill the reader with the replies of the recorded actions.
+    line_reader *reader = malloc( sizeof( line_reader ) );
+    message_buffer *message = calloc( 1, sizeof( message_buffer ) );
+    if ( ! reader || ! message ) {
+        free( reader );
+        free( message );
+        return;
+    }
+    message_clear( message );
+    int32_t number_of_lines = 0;
+    for ( int32_t i = 0; i < states->number_of_states && message->length + 8 < sizeof( reader->buffer ); i++ ) {
+        write_play_action( message, states->actions[i] );
+        number_of_lines++;
+    }
+    line_reader_init( reader, -1 );
+    memcpy( reader->buffer, message->buffer, message->length );
+
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        if ( i % number_of_lines == 0 ) {
+            reader->begin = 0;
+            reader->end = message->length;
+        }
+        sum += read_play( reader ).card;
+    }
+    bench_report( "read_play", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+    free( message );
+    free( reader );
+}
+
+void bench_player_read( const bench_states *states )
+{
+    // lines of a PLAY message as the player reads them.
+    char (*hands)[k_max_line] = malloc( states->number_of_states * sizeof( *hands ) );
+    char (*actions)[k_max_line] = malloc( states->number_of_states * sizeof( *actions ) );
+    message_buffer *message = calloc( 1, sizeof( message_buffer ) );
+    if ( ! hands || ! actions || ! message ) {
+        free( hands );
+        free( actions );
+        free( message );
+        return;
+    }
+    int16_t sequence[k_max_hands+1];
+    for ( int32_t i = 0; i < states->number_of_states; i++ ) {
+        message_clear( message );
+        hands_sequence( &states->states[i].players[0], sequence );
+        write_sequence( message, sequence );
+        write_play_action( message, states->actions[i] );
+        const size_t hands_length = strchr( message->buffer, '\n' ) - message->buffer + 1;
+        memcpy( hands[i], message->buffer, hands_length );
+        hands[i][hands_length] = '\0';
+        memcpy( actions[i], message->buffer + hands_length, message->length - hands_length );
+        actions[i][message->length - hands_length] = '\0';
+    }
+
+    card_t cards[k_max_hands+1];
+    int64_t sum = 0;
+    double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        sum += card_array_read( cards, k_max_hands, hands[i % states->number_of_states] );
+    }
+    bench_report( "card_array_read", bench_iterations, bench_now() - begin );
+
+    begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        sum += action_read( actions[i % states->number_of_states] ).card;
+    }
+    bench_report( "action_read", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+    free( message );
+    free( actions );
+    free( hands );
+}
+
+void bench_protocol( const bench_states *states )
+{
+    uint8_t frame[k_protocol_max_frame];
+    int16_t hands_p1[k_max_hands+1];
+    int16_t hands_p2[k_max_hands+1];
+    protocol_play play;
+    int64_t sum = 0;
+    const double begin = bench_now();
+    for ( int64_t i = 0; i < bench_iterations; i++ ) {
+        const game_state *state = &states->states[i % states->number_of_states];
+        hands_sequence( &state->players[0], hands_p1 );
+        hands_sequence( &state->players[1], hands_p2 );
+        protocol_encode_play( frame, state->index_of_turn, hands_p1, hands_p2, place_top( &state->left ), place_top( &state->right ), state->previous[0], state->previous[1] );
+        protocol_decode_play( frame + 1, &play );
+        sum += play.top_left;
+    }
+    bench_report( "protocol_encode_play+decode", bench_iterations, bench_now() - begin );
+    bench_sink += sum;
+}
+
+// simulates the same games with the batch simulator and the rules, and compares every result.
+bool bench_batch( void )
+{
+    batch_result *batch = malloc( bench_simulations * sizeof( batch_result ) );
+    batch_result *reference = malloc( bench_simulations * sizeof( batch_result ) );
+    if ( ! batch || ! reference ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        free( batch );
+        free( reference );
+        return false;
+    }
+
+    deal_source deals;
+    if ( ! deal_source_init( &deals, bench_seed, NULL, k_bench_deal_games ) ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        free( batch );
+        free( reference );
+        return false;
+    }
+    double begin = bench_now();
+    bool simulated = batch_simulate( batch, &deals, bench_seed + 1, 0, bench_simulations );
+    const double batch_seconds = bench_now() - begin;
+    begin = bench_now();
+    simulated = batch_simulate_reference( reference, &deals, bench_seed + 1, 0, bench_simulations ) && simulated;
+    const double reference_seconds = bench_now() - begin;
+    deal_source_free( &deals );
+    if ( ! simulated ) {
+        fprintf( stderr, "error: 山札を配れませんでした(%d).\n", __LINE__ );
+        free( batch );
+        free( reference );
+        return false;
+    }
+
+    int64_t number_of_turns = 0;
+    int32_t number_of_differences = 0;
+    for ( int32_t i = 0; i < bench_simulations; i++ ) {
+        number_of_turns += reference[i].number_of_turns;
+        if ( batch[i].points_p1 != reference[i].points_p1 || batch[i].points_p2 != reference[i].points_p2 || batch[i].number_of_turns != reference[i].number_of_turns ) {
+            if ( number_of_differences++ == 0 ) {
+                fprintf( stderr, "error: %d 番目のゲームの結果がルールと一致しません(%d).\n", i, __LINE__ );
+            }
+        }
+    }
+    fprintf( stdout, "{\"benchmark\":\"batch_simulate\",\"lanes\":%d,\"games\":%d,\"turns\":%lld,\"seconds\":%.6f,\"games_per_sec\":%.1f,\"identical\":%s}\n",
+             batch_number_of_lanes(), bench_simulations, (long long)number_of_turns, batch_seconds, bench_simulations / batch_seconds, number_of_differences == 0 ? "true" : "false" );
+    fprintf( stdout, "{\"benchmark\":\"batch_simulate_reference\",\"games\":%d,\"turns\":%lld,\"seconds\":%.6f,\"games_per_sec\":%.1f}\n",
+             bench_simulations, (long long)number_of_turns, reference_seconds, bench_simulations / reference_seconds );
+    free( reference );
+    free( batch );
+    return number_of_differences == 0;
+}
+
+// read() and write() calls of a process so far, from /proc on Linux. -1 elsewhere.
+int64_t bench_syscalls( const pid_t pid )
+{
+    char filename[64];
+    snprintf( filename, sizeof( filename ), "/proc/%d/io", (int)pid );
+    FILE *file = fopen( filename, "r" );
+    if ( ! file ) return -1;
+    int64_t count = 0;
+    int32_t found = 0;
+    char line[k_max_line];
+    long long value;
+    while ( fgets( line, sizeof( line ), file ) ) {
+        if ( sscanf( line, "syscr: %lld", &value ) == 1 || sscanf( line, "syscw: %lld", &value ) == 1 ) {
+            count += value;
+            found++;
+        }
+    }
+    fclose( file );
+    return found == 2 ? count : -1;
+}
+
+// plays games between two launched players the way the server does.
+bool bench_end_to_end( void )
+{
+    const char *arguments[k_max_arg+1] = {};
+    if ( bench_binary ) arguments[0] = "--binary";
+
+    player p1;
+    player p2;
+    player_init( &p1, NULL );
+    player_init( &p2, NULL );
+    bool ready = player_launch( &p1, bench_player, arguments ) && player_launch( &p2, bench_player, arguments );
+    option_output = output_silent;
+
+    replay_buffer replay = {};
+    int64_t number_of_moves = 0;
+    int32_t score_p1 = 0;
+    int32_t score_p2 = 0;
+    const int64_t syscalls_server = bench_syscalls( getpid() );
+    const int64_t syscalls_p1 = ready ? bench_syscalls( p1.pid ) : -1;
+    const int64_t syscalls_p2 = ready ? bench_syscalls( p2.pid ) : -1;
+    const double begin = bench_now();
+    for ( int32_t i = 0; ready && i < bench_games; i++ ) {
+        int16_t deck_p1[k_number_of_deck];
+        int16_t deck_p2[k_number_of_deck];
+        deck_deal( deck_p1, deck_p2, bench_seed, i );
+        replay.number_of_actions = 0;
+        ready = run_game( &p1, &p2, i, deck_p1, deck_p2, NULL, &replay, &score_p1, &score_p2 ) == EXIT_SUCCESS;
+        number_of_moves += replay.number_of_actions;
+    }
+    const double seconds = bench_now() - begin;
+
+    // counters of the players are read before they exit.
+    int64_t syscalls = -1;
+    if ( ready && syscalls_server >= 0 && syscalls_p1 >= 0 && syscalls_p2 >= 0 ) {
+        syscalls = bench_syscalls( getpid() ) - syscalls_server;
+        syscalls += bench_syscalls( p1.pid ) - syscalls_p1;
+        syscalls += bench_syscalls( p2.pid ) - syscalls_p2;
+    }
+    player_close( &p1 );
+    player_close( &p2 );
+    free( replay.actions );
+    if ( ! ready ) return false;
+
+    fprintf( stdout, "{\"benchmark\":\"end_to_end\",\"binary\":%s,\"games\":%d,\"moves\":%lld,\"seconds\":%.6f,\"games_per_sec\":%.1f,\"moves_per_sec\":%.1f,\"syscalls_per_move\":%.3f}\n",
+             bench_binary ? "true" : "false", bench_games, (long long)number_of_moves, seconds, bench_games / seconds, number_of_moves / seconds,
+             syscalls >= 0 && number_of_moves > 0 ? (double)syscalls / number_of_moves : -1.0 );
+    return true;
+}
+
+int main( const int argc, const char *argv[] )
+{
+    // get options.
+    for ( int i = 1; i < argc; i++ ) {
+        if ( i+1 < argc && strcmp( argv[i], "--iterations" ) == 0 ) {
+            bench_iterations = atoll( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--games" ) == 0 ) {
+            bench_games = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--simulations" ) == 0 ) {
+            bench_simulations = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--player" ) == 0 ) {
+            bench_player = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--seed" ) == 0 ) {
+            bench_seed = strtoull( argv[++i], NULL, 10 );
+        } else if ( i+1 < argc && strcmp( argv[i], "--replay" ) == 0 ) {
+            bench_replay = argv[++i];
+        } else if ( strcmp( argv[i], "--binary" ) == 0 ) {
+            bench_binary = true;
+        } else {
+            fprintf( stdout, "error: 不明な引数 %s が与えられました.\n", argv[i] );
+            bench_usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if ( bench_iterations < 1 || bench_games < 0 || bench_simulations < 0 ) {
+        fprintf( stdout, "error: 引数 --iterations には1以上, --games と --simulations には0以上を与えてください.\n" );
+        bench_usage();
+        return EXIT_FAILURE;
+    }
+    signal( SIGPIPE, SIG_IGN );
+
+    bench_states states = {};
+    states.states = malloc( k_bench_max_states * sizeof( game_state ) );
+    states.actions = malloc( k_bench_max_states * sizeof( play_action ) );
+    if ( ! states.states || ! states.actions ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        return EXIT_FAILURE;
+    }
+    if ( bench_replay ) {
+        if ( ! bench_states_replay( &states, bench_replay ) ) return EXIT_FAILURE;
+    } else {
+        bench_states_random( &states );
+    }
+
+    int exit_code = EXIT_SUCCESS;
+    bench_candidates( &states );
+    bench_sequence( &states );
+    bench_shuffle();
+    if ( ! bench_deal() ) exit_code = EXIT_FAILURE;
+    bench_player_play( &states );
+    bench_write_sequence( &states );
+    bench_write_play( &states, false );
+    bench_write_play( &states, true );
+    bench_read_play( &states );
+    bench_player_read( &states );
+    bench_protocol( &states );
+
+    if ( bench_simulations > 0 && ! bench_batch() ) exit_code = EXIT_FAILURE;
+    if ( bench_games > 0 && ! bench_end_to_end() ) exit_code = EXIT_FAILURE;
+
+    free( states.actions );
+    free( states.states );
+    return exit_code;
+}
@@ -0,0 +1,123 @@
+#include "Slow-Dataset.h"
+#include "Slow-Protocol.h"
+
+#include <string.h>
+
+static size_t align8( const size_t size )
+{
+    return ( size + 7 ) & ~(size_t)7;
+}
+
+size_t dataset_column_offset( const int32_t number_of_positions, const dataset_column column )
+{
+    size_t offset = k_dataset_chunk_header_size;
+    for ( int32_t c = 0; c < (int32_t)column; c++ ) {
+        offset += align8( k_dataset_column_sizes[c] * (size_t)number_of_positions );
+    }
+    return offset;
+}
+
+size_t dataset_chunk_size( const int32_t number_of_positions )
+{
+    return dataset_column_offset( number_of_positions, dataset_number_of_columns );
+}
+
+size_t dataset_encode_header( uint8_t *it, const int32_t number_of_chunks, const int64_t number_of_positions, const uint64_t index_offset )
+{
+    memcpy( it, SLOW_DATASET_MAGIC, 8 );
+    put_uint32( it + 8, k_dataset_version );
+    put_uint32( it + 12, (uint32_t)number_of_chunks );
+    put_uint64( it + 16, (uint64_t)number_of_positions );
+    put_uint64( it + 24, index_offset );
+    return k_dataset_header_size;
+}
+
+size_t dataset_encode_chunk_header( uint8_t *it, const int32_t number_of_positions )
+{
+    put_uint32( it, (uint32_t)number_of_positions );
+    put_uint32( it + 4, 0 );
+    return k_dataset_chunk_header_size;
+}
+
+static void encode_hands( uint8_t *it, const int16_t *hands )
+{
+    for ( int32_t i = 0; i < k_max_hands; i++ ) {
+        it[i] = (uint8_t)*hands;
+        if ( *hands != 0 ) hands++;
+    }
+}
+
+static void decode_hands( const uint8_t *it, int16_t *hands )
+{
+    for ( int32_t i = 0; i < k_max_hands && it[i] != 0; i++ ) {
+        *(hands++) = it[i];
+    }
+    *hands = 0;
+}
+
+void dataset_encode_row( uint8_t *const *columns, const int32_t index, const dataset_row *row )
+{
+    put_uint32( columns[dataset_column_game] + index * 4, (uint32_t)row->index_of_game );
+    put_uint16( columns[dataset_column_turn] + index * 2, (uint16_t)row->turn );
+    columns[dataset_column_seat][index] = (uint8_t)row->seat;
+    encode_hands( columns[dataset_column_you_hands] + index * k_max_hands, row->you_hands );
+    encode_hands( columns[dataset_column_op_hands] + index * k_max_hands, row->op_hands );
+    columns[dataset_column_top_left][index] = (uint8_t)row->top_left;
+    columns[dataset_column_top_right][index] = (uint8_t)row->top_right;
+    columns[dataset_column_you_deck][index] = (uint8_t)row->you_deck;
+    columns[dataset_column_op_deck][index] = (uint8_t)row->op_deck;
+    columns[dataset_column_you_previous][index] = protocol_encode_action( row->you_previous );
+    columns[dataset_column_op_previous][index] = protocol_encode_action( row->op_previous );
+    columns[dataset_column_action][index] = protocol_encode_action( row->action );
+    put_uint16( columns[dataset_column_you_points] + index * 2, (uint16_t)row->you_points );
+    put_uint16( columns[dataset_column_op_points] + index * 2, (uint16_t)row->op_points );
+}
+
+void dataset_decode_row( const dataset_chunk *chunk, const int32_t index, dataset_row *row )
+{
+    const uint8_t *const *columns = chunk->columns;
+    row->index_of_game = (int32_t)get_uint32( columns[dataset_column_game] + index * 4 );
+    row->turn = get_uint16( columns[dataset_column_turn] + index * 2 );
+    row->seat = columns[dataset_column_seat][index];
+    decode_hands( columns[dataset_column_you_hands] + index * k_max_hands, row->you_hands );
+    decode_hands( columns[dataset_column_op_hands] + index * k_max_hands, row->op_hands );
+    row->top_left = columns[dataset_column_top_left][index];
+    row->top_right = columns[dataset_column_top_right][index];
+    row->you_deck = columns[dataset_column_you_deck][index];
+    row->op_deck = columns[dataset_column_op_deck][index];
+    row->you_previous = protocol_decode_action( columns[dataset_column_you_previous][index] );
+    row->op_previous = protocol_decode_action( columns[dataset_column_op_previous][index] );
+    row->action = protocol_decode_action( columns[dataset_column_action][index] );
+    row->you_points = (int16_t)get_uint16( columns[dataset_column_you_points] + index * 2 );
+    row->op_points = (int16_t)get_uint16( columns[dataset_column_op_points] + index * 2 );
+}
+
+bool dataset_decode_header( const uint8_t *data, const size_t size, dataset_header *header )
+{
+    if ( size < k_dataset_header_size ) return false;
+    if ( memcmp( data, SLOW_DATASET_MAGIC, 8 ) != 0 ) return false;
+    if ( get_uint32( data + 8 ) != k_dataset_version ) return false;
+
+    header->number_of_chunks = (int32_t)get_uint32( data + 12 );
+    header->number_of_positions = (int64_t)get_uint64( data + 16 );
+    header->index_offset = get_uint64( data + 24 );
+    if ( header->number_of_chunks < 0 || header->number_of_positions < 0 ) return false;
+    if ( header->index_offset > size ) return false;
+    return ( size - header->index_offset ) / 8 >= (uint64_t)header->number_of_chunks;
+}
+
+bool dataset_decode_chunk( const uint8_t *data, const size_t size, const dataset_header *header, const int32_t n, dataset_chunk *chunk )
+{
+    if ( n < 0 || n >= header->number_of_chunks ) return false;
+    const uint64_t offset = get_uint64( data + header->index_offset + (uint64_t)n * 8 );
+    if ( offset < k_dataset_header_size || offset > size || size - offset < k_dataset_chunk_header_size ) return false;
+
+    const uint8_t *it = data + offset;
+    const uint32_t number_of_positions = get_uint32( it );
+    if ( number_of_positions > INT32_MAX || dataset_chunk_size( (int32_t)number_of_positions ) > size - offset ) return false;
+    chunk->number_of_positions = (int32_t)number_of_positions;
+    for ( int32_t c = 0; c < dataset_number_of_columns; c++ ) {
+        chunk->columns[c] = it + dataset_column_offset( chunk->number_of_positions, (dataset_column)c );
+    }
+    return true;
+}
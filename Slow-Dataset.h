@@ -0,0 +1,129 @@
+#ifndef SLOW_DATASET_H
+#define SLOW_DATASET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Slow-Rule.h"
+
+//!
+//! 評価関数の学習に使う局面のデータセットの形式です.
+//!
+//! 1行は1つの手番の局面で, 手番のプレイヤーから見た特徴と選んだ行動, そのゲームの最終的なポイントを持ちます.
+//! 局面はチャンクに分けて列ごとに並べるので, ファイルをメモリに写像すれば列をそのまま配列として読めます.
+//! すべてリトルエンディアンの固定の並びです.
+//!
+//!  ヘッダー  : magic(8) version(4) number_of_chunks(4) number_of_positions(8) index_offset(8)
+//!  チャンク  : number_of_positions(4) reserved(4) 列 x dataset_number_of_columns
+//!  索引      : offset(8) x number_of_chunks
+//!
+//! チャンクの列は dataset_column の順に number_of_positions 個の要素を並べ, 各列は8バイト境界から始まります.
+//! 列の位置は dataset_column_offset で求められます. 索引の n 番目はファイルの先頭から n 番目のチャンクまでのバイト数です.
+//! 手札は番号を昇順に並べて5枚に満たない分を 0 で埋め, 行動は Slow-Protocol.h の行動の1バイトです.
+//!
+
+#define SLOW_DATASET_MAGIC "SLOWDATA"   //!< ファイルの先頭の8バイト
+
+static const uint32_t k_dataset_version = 1;            //!< 形式のバージョン
+static const size_t k_dataset_header_size = 32;         //!< ヘッダーのバイト数
+static const size_t k_dataset_chunk_header_size = 8;    //!< チャンクの先頭のバイト数
+
+//! 列. 要素の型はコメントの通り.
+typedef enum {
+    dataset_column_game = 0,    //!< int32 ゲームの番号
+    dataset_column_turn,        //!< uint16 ターンの番号
+    dataset_column_seat,        //!< uint8 手番のプレイヤー. P1 は 0, P2 は 1.
+    dataset_column_you_hands,   //!< uint8[5] 手番のプレイヤーの手札
+    dataset_column_op_hands,    //!< uint8[5] 相手の手札
+    dataset_column_top_left,    //!< uint8 場の左の一番上の札. 無ければ 0.
+    dataset_column_top_right,   //!< uint8 場の右の一番上の札. 無ければ 0.
+    dataset_column_you_deck,    //!< uint8 手番のプレイヤーの山札の残りの枚数
+    dataset_column_op_deck,     //!< uint8 相手の山札の残りの枚数
+    dataset_column_you_previous,//!< uint8 手番のプレイヤーの前回の行動
+    dataset_column_op_previous, //!< uint8 相手の前回の行動
+    dataset_column_action,      //!< uint8 選んだ行動
+    dataset_column_you_points,  //!< int16 手番のプレイヤーがそのゲームで得たポイント
+    dataset_column_op_points,   //!< int16 相手がそのゲームで得たポイント
+    dataset_number_of_columns
+} dataset_column;
+
+//! 列の1要素のバイト数. 手札は k_max_hands 枚.
+static const size_t k_dataset_column_sizes[dataset_number_of_columns] = { 4, 2, 1, 5, 5, 1, 1, 1, 1, 1, 1, 1, 2, 2 };
+
+//! 1つの局面の行
+typedef struct {
+    int32_t index_of_game;
+    int32_t turn;
+    int32_t seat;
+    int16_t you_hands[k_max_hands+1];   //!< 0 終端
+    int16_t op_hands[k_max_hands+1];    //!< 0 終端
+    int16_t top_left;
+    int16_t top_right;
+    int32_t you_deck;
+    int32_t op_deck;
+    play_action you_previous;
+    play_action op_previous;
+    play_action action;
+    int32_t you_points;
+    int32_t op_points;
+} dataset_row;
+
+//! ヘッダーの内容
+typedef struct {
+    int32_t number_of_chunks;
+    int64_t number_of_positions;
+    uint64_t index_offset;
+} dataset_header;
+
+//! 1チャンクの列. 読む場合はファイルの中を指します.
+typedef struct {
+    int32_t number_of_positions;
+    const uint8_t *columns[dataset_number_of_columns];
+} dataset_chunk;
+
+//! @return 局面の数が number_of_positions のチャンクの先頭から列までのバイト数
+size_t dataset_column_offset( const int32_t number_of_positions, const dataset_column column );
+
+//! @return 局面の数が number_of_positions のチャンクのバイト数
+size_t dataset_chunk_size( const int32_t number_of_positions );
+
+//! @return バイト数
+size_t dataset_encode_header( uint8_t *it, const int32_t number_of_chunks, const int64_t number_of_positions, const uint64_t index_offset );
+
+//!
+//! @brief  行を列の index 番目に書き込みます
+//!
+//! @param  columns [out]列ごとの配列. 列の要素のバイト数 x 局面の数以上.
+//!
+void dataset_encode_row( uint8_t *const *columns, const int32_t index, const dataset_row *row );
+
+//! チャンクの index 番目の行を読みます
+void dataset_decode_row( const dataset_chunk *chunk, const int32_t index, dataset_row *row );
+
+//!
+//! @brief  チャンクの先頭を書き込みます
+//!
+//! 列はこの後に dataset_column の順に書き, それぞれ8バイト境界まで 0 で埋めます.
+//!
+//! @return バイト数
+//!
+size_t dataset_encode_chunk_header( uint8_t *it, const int32_t number_of_positions );
+
+//!
+//! @brief  ファイル全体からヘッダーを読みます
+//!
+//! @return 形式が正しくなければ false
+//!
+bool dataset_decode_header( const uint8_t *data, const size_t size, dataset_header *header );
+
+//!
+//! @brief  ファイル全体から索引を使って n 番目のチャンクを読みます
+//!
+//! @param  chunk   [out]columns は data の中を指す
+//!
+//! @return 範囲外であれば false
+//!
+bool dataset_decode_chunk( const uint8_t *data, const size_t size, const dataset_header *header, const int32_t n, dataset_chunk *chunk );
+
+#endif
@@ -0,0 +1,207 @@
+#include "Slow-Deal.h"
+#include "Slow-Lanes.h"
+#include "Slow-Protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// games encoded at once by deal_file_write.
+static const int32_t k_deal_write_games = 4096;
+
+void deal_decks( int16_t *decks, const uint64_t seed, const int32_t index_of_game, const int32_t number_of_games )
+{
+#if SLOW_LANES < 16
+    // splitmix64 multiplies 64 bit lanes, which narrower vectors emulate no faster than a game at a time.
+    for ( int32_t i = 0; i < number_of_games; i++ ) {
+        int16_t *deck = decks + (size_t)i * 2 * k_number_of_deck;
+        deck_deal( deck, deck + k_number_of_deck, seed, index_of_game + i );
+    }
+#else
+    const lanes zero = {0};
+    for ( int32_t begin = 0; begin < number_of_games; begin += SLOW_LANES ) {
+        const int32_t count = number_of_games - begin < SLOW_LANES ? number_of_games - begin : SLOW_LANES;
+        lanes64 random = {0};
+        lanes active = zero;
+        for ( int32_t l = 0; l < count; l++ ) {
+            game_random lane_random;
+            game_random_seed_stream( &lane_random, seed, (uint64_t)( index_of_game + begin + l ) );
+            LANE( random, l ) = lane_random.state;
+            LANE( active, l ) = UINT32_MAX;
+        }
+
+        // the i-th swap has the same bound in every game, as deck_shuffle. a game that may need
+        // another random number is dealt again by deck_deal.
+        uint32_t offsets[2 * k_number_of_deck][SLOW_LANES];
+        lanes uncertain = zero;
+        for ( int32_t i = 0; i < 2 * k_number_of_deck; i++ ) {
+            lanes uncertain_once;
+            lanes low;
+            const lanes offset = lanes_random_bounded_once( &random, zero + (uint32_t)( k_number_of_deck - i % k_number_of_deck ), active, &uncertain_once, &low );
+            memcpy( offsets[i], &offset, sizeof( offset ) );
+            uncertain |= uncertain_once;
+        }
+
+        for ( int32_t l = 0; l < count; l++ ) {
+            int16_t *deck = decks + (size_t)( begin + l ) * 2 * k_number_of_deck;
+            if ( LANE( uncertain, l ) ) {
+                deck_deal( deck, deck + k_number_of_deck, seed, index_of_game + begin + l );
+                continue;
+            }
+            deck_init( deck );
+            deck_init( deck + k_number_of_deck );
+            for ( int32_t i = 0; i < 2 * k_number_of_deck; i++ ) {
+                int16_t *v1 = deck + i;
+                int16_t *v2 = v1 + offsets[i][l];
+                const int16_t t = *v1;
+                *v1 = *v2;
+                *v2 = t;
+            }
+        }
+    }
+#endif
+}
+
+size_t deal_encode_header( uint8_t *it, const int32_t number_of_games, const uint64_t seed )
+{
+    memcpy( it, SLOW_DEAL_MAGIC, 8 );
+    put_uint32( it + 8, k_deal_version );
+    put_uint32( it + 12, (uint32_t)number_of_games );
+    put_uint32( it + 16, (uint32_t)seed );
+    put_uint32( it + 20, (uint32_t)( seed >> 32 ) );
+    return k_deal_header_size;
+}
+
+size_t deal_encode_game( uint8_t *it, const int16_t *deck_p1, const int16_t *deck_p2 )
+{
+    for ( int32_t i = 0; i < k_number_of_deck; i++ ) {
+        it[i] = (uint8_t)deck_p1[i];
+        it[k_number_of_deck + i] = (uint8_t)deck_p2[i];
+    }
+    return k_deal_game_size;
+}
+
+bool deal_decode_header( const uint8_t *data, const size_t size, deal_header *header )
+{
+    if ( size < k_deal_header_size ) return false;
+    if ( memcmp( data, SLOW_DEAL_MAGIC, 8 ) != 0 ) return false;
+    if ( get_uint32( data + 8 ) != k_deal_version ) return false;
+
+    const uint32_t number_of_games = get_uint32( data + 12 );
+    if ( number_of_games > INT32_MAX ) return false;
+    header->number_of_games = (int32_t)number_of_games;
+    header->seed = (uint64_t)get_uint32( data + 16 ) | ( (uint64_t)get_uint32( data + 20 ) << 32 );
+    return ( size - k_deal_header_size ) / k_deal_game_size >= number_of_games;
+}
+
+bool deal_decode_game( const uint8_t *data, const deal_header *header, const int32_t n, int16_t *deck_p1, int16_t *deck_p2 )
+{
+    if ( n < 0 || n >= header->number_of_games ) return false;
+    const uint8_t *it = data + k_deal_header_size + (size_t)n * k_deal_game_size;
+    for ( int32_t i = 0; i < k_number_of_deck; i++ ) {
+        deck_p1[i] = it[i];
+        deck_p2[i] = it[k_number_of_deck + i];
+    }
+    return deck_is_valid( deck_p1 ) && deck_is_valid( deck_p2 );
+}
+
+bool deal_file_write( const char *filename, const uint64_t seed, const int32_t number_of_games )
+{
+    FILE *file = fopen( filename, "wb" );
+    int16_t *decks = malloc( (size_t)k_deal_write_games * 2 * k_number_of_deck * sizeof( int16_t ) );
+    uint8_t *buffer = malloc( (size_t)k_deal_write_games * k_deal_game_size );
+    bool written = file && decks && buffer;
+
+    uint8_t header[k_deal_header_size];
+    deal_encode_header( header, number_of_games, seed );
+    if ( written ) written = fwrite( header, 1, sizeof( header ), file ) == sizeof( header );
+
+    for ( int32_t begin = 0; written && begin < number_of_games; begin += k_deal_write_games ) {
+        const int32_t count = number_of_games - begin < k_deal_write_games ? number_of_games - begin : k_deal_write_games;
+        deal_decks( decks, seed, begin, count );
+        uint8_t *it = buffer;
+        for ( int32_t i = 0; i < count; i++ ) {
+            const int16_t *deck = decks + (size_t)i * 2 * k_number_of_deck;
+            it += deal_encode_game( it, deck, deck + k_number_of_deck );
+        }
+        written = fwrite( buffer, 1, it - buffer, file ) == (size_t)( it - buffer );
+    }
+
+    free( buffer );
+    free( decks );
+    if ( file && fclose( file ) != 0 ) written = false;
+    return written;
+}
+
+bool deal_file_read( deal_file *file, const char *filename )
+{
+    memset( file, 0, sizeof( *file ) );
+    FILE *it = fopen( filename, "rb" );
+    if ( ! it ) return false;
+    fseek( it, 0, SEEK_END );
+    const long size = ftell( it );
+    fseek( it, 0, SEEK_SET );
+    file->data = size > 0 ? malloc( size ) : NULL;
+    const bool loaded = file->data && fread( file->data, 1, size, it ) == (size_t)size;
+    fclose( it );
+
+    file->size = loaded ? (size_t)size : 0;
+    bool valid = loaded && deal_decode_header( file->data, file->size, &file->header );
+
+    // every deck is checked once here, so a source only fails out of range.
+    int16_t deck_p1[k_number_of_deck];
+    int16_t deck_p2[k_number_of_deck];
+    for ( int32_t n = 0; valid && n < file->header.number_of_games; n++ ) {
+        valid = deal_decode_game( file->data, &file->header, n, deck_p1, deck_p2 );
+    }
+    if ( ! valid ) deal_file_free( file );
+    return valid;
+}
+
+void deal_file_free( deal_file *file )
+{
+    free( file->data );
+    memset( file, 0, sizeof( *file ) );
+}
+
+bool deal_source_init( deal_source *source, const uint64_t seed, const deal_file *file, const int32_t capacity )
+{
+    memset( source, 0, sizeof( *source ) );
+    source->seed = seed;
+    source->file = file;
+    source->capacity = capacity > 0 ? capacity : 1;
+    source->decks = malloc( (size_t)source->capacity * 2 * k_number_of_deck * sizeof( int16_t ) );
+    return source->decks != NULL;
+}
+
+void deal_source_free( deal_source *source )
+{
+    free( source->decks );
+    source->decks = NULL;
+    source->number_of_decks = 0;
+}
+
+const int16_t *deal_source_decks( deal_source *source, const int32_t index_of_game )
+{
+    if ( index_of_game < 0 ) return NULL;
+    if ( index_of_game < source->index_of_first || index_of_game - source->index_of_first >= source->number_of_decks ) {
+        // deal the block that holds the game.
+        const int32_t first = index_of_game - index_of_game % source->capacity;
+        int32_t count = INT32_MAX - first < source->capacity ? INT32_MAX - first : source->capacity;
+        source->number_of_decks = 0;
+        if ( source->file ) {
+            const int32_t number_of_games = source->file->header.number_of_games;
+            if ( index_of_game >= number_of_games ) return NULL;
+            if ( count > number_of_games - first ) count = number_of_games - first;
+            for ( int32_t i = 0; i < count; i++ ) {
+                int16_t *deck = source->decks + (size_t)i * 2 * k_number_of_deck;
+                if ( ! deal_decode_game( source->file->data, &source->file->header, first + i, deck, deck + k_number_of_deck ) ) return NULL;
+            }
+        } else {
+            deal_decks( source->decks, source->seed, first, count );
+        }
+        source->index_of_first = first;
+        source->number_of_decks = count;
+    }
+    return source->decks + (size_t)( index_of_game - source->index_of_first ) * 2 * k_number_of_deck;
+}
@@ -0,0 +1,129 @@
+#ifndef SLOW_DEAL_H
+#define SLOW_DEAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Slow-Rule.h"
+
+//!
+//! 多数のゲームの山札をまとめて配るための仕組みです.
+//!
+//! deal_decks は deck_deal と同じ山札を, 複数のゲームの乱数列を Slow-Lanes.h の並びで同時に進めて作ります.
+//! 山札を混ぜる i 回目の乱数の範囲はどのゲームでも同じなので, 乱数はゲームをまたいでまとめて作り, 入れ替えだけを1ゲームずつ行います.
+//! 乱数は 64 ビットの掛け算を使うので, 並びが 16 に満たない命令セットでは速くならず, deck_deal で1ゲームずつ配ります.
+//!
+//! deal_source は確保済みのバッファにまとめて配った山札を番号の順に渡します.
+//! 山札のファイルを与えると, seed の代わりにファイルの山札を渡すので, 同じ山札の組を別の実行でも使えます.
+//!
+//! 山札のファイルはすべて固定の並びです.
+//!
+//!  ヘッダー  : magic(8) version(4) number_of_games(4) seed(8)
+//!  ゲーム    : deck_p1(26) deck_p2(26) x number_of_games
+//!
+//! 山札は配られた順に1枚1バイトで, n 番目のゲームはファイルの先頭から k_deal_header_size + k_deal_game_size x n バイト目にあります.
+//! seed は山札を作った乱数の種で, 記録のためだけのものです.
+//!
+
+#define SLOW_DEAL_MAGIC "SLOWDEAL"      //!< ファイルの先頭の8バイト
+
+static const uint32_t k_deal_version = 1;           //!< 形式のバージョン
+static const size_t k_deal_header_size = 24;        //!< ヘッダーのバイト数
+static const size_t k_deal_game_size = 52;          //!< 1ゲームの山札のバイト数
+
+//! ヘッダーの内容
+typedef struct {
+    int32_t number_of_games;
+    uint64_t seed;
+} deal_header;
+
+//! 読み込んだ山札のファイル
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    deal_header header;
+} deal_file;
+
+//! 番号の順に山札を渡すバッファ
+typedef struct {
+    uint64_t seed;
+    const deal_file *file;      //!< NULL であれば seed から配る
+    int16_t *decks;             //!< capacity ゲーム分の山札
+    int32_t capacity;
+    int32_t index_of_first;     //!< decks の先頭のゲームの番号
+    int32_t number_of_decks;    //!< decks にあるゲームの数
+} deal_source;
+
+//!
+//! @brief  index_of_game 番目から number_of_games 個のゲームの山札をまとめて配ります
+//!
+//! i 番目のゲームの deck_p1 は decks + i x 2 x k_number_of_deck, deck_p2 はその k_number_of_deck 後にあり,
+//! deck_deal( deck_p1, deck_p2, seed, index_of_game + i ) と同じ山札になります.
+//!
+//! @param  decks   [out]number_of_games x 2 x k_number_of_deck 以上の配列
+//!
+void deal_decks( int16_t *decks, const uint64_t seed, const int32_t index_of_game, const int32_t number_of_games );
+
+//! @return バイト数
+size_t deal_encode_header( uint8_t *it, const int32_t number_of_games, const uint64_t seed );
+
+//! @return バイト数
+size_t deal_encode_game( uint8_t *it, const int16_t *deck_p1, const int16_t *deck_p2 );
+
+//!
+//! @brief  ファイル全体からヘッダーを読みます
+//!
+//! @return 形式が正しくないか, ゲームの数だけの山札が無ければ false
+//!
+bool deal_decode_header( const uint8_t *data, const size_t size, deal_header *header );
+
+//!
+//! @brief  ファイル全体から n 番目のゲームの山札を読みます
+//!
+//! @return 範囲外であるか, 山札が 1 から 13 を2枚ずつ並べたものでなければ false
+//!
+bool deal_decode_game( const uint8_t *data, const deal_header *header, const int32_t n, int16_t *deck_p1, int16_t *deck_p2 );
+
+//!
+//! @brief  seed の 0 番目から number_of_games 個のゲームの山札をファイルに書き込みます
+//!
+//! @return 書き込めなければ false
+//!
+bool deal_file_write( const char *filename, const uint64_t seed, const int32_t number_of_games );
+
+//!
+//! @brief  山札のファイルを読み込みます
+//!
+//! すべての山札が 1 から 13 を2枚ずつ並べたものであることも確かめます.
+//!
+//! @return 読み込めないか形式が正しくなければ false
+//!
+bool deal_file_read( deal_file *file, const char *filename );
+
+void deal_file_free( deal_file *file );
+
+//!
+//! @brief  山札を渡すバッファを確保します
+//!
+//! @param  file        [in]NULL であれば seed から配る. deal_source より長く残すこと.
+//! @param  capacity    [in]1度にまとめて配るゲームの数
+//!
+//! @return 確保できなければ false
+//!
+bool deal_source_init( deal_source *source, const uint64_t seed, const deal_file *file, const int32_t capacity );
+
+void deal_source_free( deal_source *source );
+
+//!
+//! @brief  index_of_game 番目のゲームの山札を取得します
+//!
+//! バッファに無ければ, index_of_game を含む capacity の倍数の番号からの capacity 個のゲームをまとめて配ります.
+//! 番号の順に取得すれば capacity ゲームに1度だけ配ります.
+//!
+//! @return deck_p1 の先頭. deck_p2 はその k_number_of_deck 後. 次に呼ぶまで有効.
+//!         ファイルのゲームの数を超えれば NULL.
+//!
+const int16_t *deal_source_decks( deal_source *source, const int32_t index_of_game );
+
+#endif
@@ -0,0 +1,530 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Slow-Rule.h"
+#include "Slow-Protocol.h"
+#include "Slow-Dataset.h"
+#include "Slow-Deal.h"
+
+// constants.
+static const int32_t k_generate_games_per_take = 64;    // games a thread takes from the counter at once.
+
+// options
+static const char *option_output = NULL;
+static const char *option_read = NULL;
+static const char *option_deals = NULL;
+static const char *option_write_deals = NULL;
+static int32_t option_number_of_games = 1000;
+static int32_t option_number_of_threads = 0;    // 0 is the number of cores.
+static int32_t option_chunk = 65536;            // positions of a chunk.
+static uint64_t option_seed = 0;
+static uint64_t option_seed1 = 0;
+static uint64_t option_seed2 = 0;
+
+void version()
+{
+    fprintf( stdout, "Slow-Generate version 0.01\n" );
+}
+
+void usage()
+{
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "使い方\n" );
+    fprintf( stdout, "./Slow-Generate --output FILE --number 100000\n" );
+    fprintf( stdout, "./Slow-Generate --read FILE\n" );
+    fprintf( stdout, "./Slow-Generate --write-deals FILE --number 100000 --seed 1\n" );
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "オプション\n" );
+    fprintf( stdout, " --output 局面を書き込むデータセットのファイル. 形式は Slow-Dataset.h を参照.\n" );
+    fprintf( stdout, " --number 自己対戦の数.\n" );
+    fprintf( stdout, " --threads 対戦するスレッドの数. 省略するとコアの数.\n" );
+    fprintf( stdout, " --chunk 1つのチャンクの局面の数. スレッドごとに1つのチャンクだけをメモリに持つ.\n" );
+    fprintf( stdout, " --seed 山札を配る乱数の種. Slow-Server の --seed と同じ山札が配られる. 省略すると現在時刻.\n" );
+    fprintf( stdout, " --seed1 P1 の行動を選ぶ乱数の種. サンプルプレイヤーの --seed と同じ行動を選ぶ. 省略すると --seed + 1.\n" );
+    fprintf( stdout, " --seed2 P2 の行動を選ぶ乱数の種. 省略すると --seed + 2.\n" );
+    fprintf( stdout, " --read --output の代わりに, 書き込んだデータセットを読んで集計する.\n" );
+    fprintf( stdout, " --deals 山札を --seed の代わりにこの山札のファイルから配る.\n" );
+    fprintf( stdout, " --write-deals --output の代わりに, --seed で配った --number 個の山札をファイルに書き込む. 形式は Slow-Deal.h を参照.\n" );
+    fprintf( stdout, " --version バージョン情報表示.\n" );
+    fprintf( stdout, "\n" );
+}
+
+// appends chunks to the dataset in the order they fill, and writes the index on close.
+typedef struct {
+    pthread_mutex_t mutex;
+    FILE *file;
+    uint64_t offset;
+    uint64_t *offsets;      // file offset of each chunk.
+    int32_t number_of_chunks;
+    int32_t capacity;
+    int64_t number_of_positions;
+} dataset_writer;
+
+static dataset_writer generate_writer = { PTHREAD_MUTEX_INITIALIZER, NULL, 0, NULL, 0, 0, 0 };
+static deal_file generate_deal_file = {};
+
+bool dataset_writer_open( dataset_writer *writer, const char *filename )
+{
+    writer->file = fopen( filename, "wb" );
+    if ( ! writer->file ) {
+        fprintf( stderr, "error: %s を開けませんでした(%d).\n", filename, __LINE__ );
+        return false;
+    }
+
+    // the header is written again with the counts and the index offset on close.
+    uint8_t header[k_dataset_header_size];
+    dataset_encode_header( header, 0, 0, 0 );
+    writer->offset = fwrite( header, 1, sizeof( header ), writer->file );
+    return writer->offset == sizeof( header );
+}
+
+bool dataset_writer_submit( dataset_writer *writer, uint8_t *const *columns, const int32_t number_of_positions )
+{
+    static const uint8_t zeros[8] = {};
+    uint8_t header[k_dataset_chunk_header_size];
+    dataset_encode_chunk_header( header, number_of_positions );
+
+    pthread_mutex_lock( &writer->mutex );
+    bool written = true;
+    if ( writer->number_of_chunks == writer->capacity ) {
+        const int32_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+        uint64_t *offsets = realloc( writer->offsets, capacity * sizeof( uint64_t ) );
+        if ( offsets ) {
+            writer->offsets = offsets;
+            writer->capacity = capacity;
+        }
+        written = offsets != NULL;
+    }
+    if ( written ) {
+        writer->offsets[writer->number_of_chunks++] = writer->offset;
+        written = fwrite( header, 1, sizeof( header ), writer->file ) == sizeof( header );
+        for ( int32_t c = 0; written && c < dataset_number_of_columns; c++ ) {
+            const size_t size = k_dataset_column_sizes[c] * (size_t)number_of_positions;
+            const size_t padding = ( 8 - size % 8 ) % 8;
+            written = fwrite( columns[c], 1, size, writer->file ) == size && fwrite( zeros, 1, padding, writer->file ) == padding;
+        }
+        writer->offset += dataset_chunk_size( number_of_positions );
+        writer->number_of_positions += number_of_positions;
+    }
+    pthread_mutex_unlock( &writer->mutex );
+
+    if ( ! written ) fprintf( stderr, "error: データセットの書き込みに失敗しました(%d).\n", __LINE__ );
+    return written;
+}
+
+bool dataset_writer_close( dataset_writer *writer )
+{
+    if ( ! writer->file ) return true;
+
+    bool written = true;
+    uint8_t bytes[8];
+    for ( int32_t i = 0; i < writer->number_of_chunks; i++ ) {
+        for ( int32_t j = 0; j < 8; j++ ) bytes[j] = (uint8_t)( writer->offsets[i] >> ( j * 8 ) );
+        written = written && fwrite( bytes, 1, sizeof( bytes ), writer->file ) == sizeof( bytes );
+    }
+    uint8_t header[k_dataset_header_size];
+    dataset_encode_header( header, writer->number_of_chunks, writer->number_of_positions, writer->offset );
+    written = written && fseek( writer->file, 0, SEEK_SET ) == 0;
+    written = written && fwrite( header, 1, sizeof( header ), writer->file ) == sizeof( header );
+    written = ( fclose( writer->file ) == 0 ) && written;
+    if ( ! written ) fprintf( stderr, "error: データセットの書き込みに失敗しました(%d).\n", __LINE__ );
+
+    free( writer->offsets );
+    writer->file = NULL;
+    writer->offsets = NULL;
+    return written;
+}
+
+// hands out game indices to the threads in blocks.
+typedef struct {
+    pthread_mutex_t mutex;
+    int32_t index_of_next_game;
+} game_counter;
+
+static game_counter generate_counter = { PTHREAD_MUTEX_INITIALIZER, 0 };
+
+bool take_games( game_counter *counter, int32_t *begin, int32_t *end )
+{
+    pthread_mutex_lock( &counter->mutex );
+    *begin = counter->index_of_next_game;
+    *end = *begin + k_generate_games_per_take;
+    if ( *end > option_number_of_games ) *end = option_number_of_games;
+    counter->index_of_next_game = *end;
+    pthread_mutex_unlock( &counter->mutex );
+    return *begin < *end;
+}
+
+// a thread of self-play. the positions of a game wait in rows until its points are known, then go to the chunk.
+typedef struct {
+    pthread_t thread;
+    uint8_t *buffer;
+    uint8_t *columns[dataset_number_of_columns];
+    int32_t number_of_positions;    // in the chunk.
+    dataset_row *rows;
+    int32_t capacity_of_rows;
+    deal_source deals;      // dealt a take at a time.
+    int64_t number_of_games;
+    int64_t score_p1;
+    int64_t score_p2;
+    bool failed;
+} generate_job;
+
+bool job_open( generate_job *job )
+{
+    size_t size = 0;
+    for ( int32_t c = 0; c < dataset_number_of_columns; c++ ) size += k_dataset_column_sizes[c] * (size_t)option_chunk;
+    job->buffer = malloc( size );
+    const deal_file *file = option_deals ? &generate_deal_file : NULL;
+    if ( ! job->buffer || ! deal_source_init( &job->deals, option_seed, file, k_generate_games_per_take ) ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    uint8_t *it = job->buffer;
+    for ( int32_t c = 0; c < dataset_number_of_columns; c++ ) {
+        job->columns[c] = it;
+        it += k_dataset_column_sizes[c] * (size_t)option_chunk;
+    }
+    return true;
+}
+
+void job_close( generate_job *job )
+{
+    free( job->buffer );
+    free( job->rows );
+    deal_source_free( &job->deals );
+    job->buffer = NULL;
+    job->rows = NULL;
+}
+
+bool job_flush( generate_job *job )
+{
+    if ( job->number_of_positions == 0 ) return true;
+    const bool written = dataset_writer_submit( &generate_writer, job->columns, job->number_of_positions );
+    job->number_of_positions = 0;
+    return written;
+}
+
+// same as play() of the sample player: a random candidate, except a pass when another action is possible.
+play_action choose_action( const play_action *candidates, const int32_t number_of_candidates, game_random *random )
+{
+    if ( number_of_candidates > 1 && candidates[number_of_candidates-1].operation == play_operation_pass ) {
+        return candidates[ game_random_bounded( random, (uint32_t)( number_of_candidates-1 ) ) ];
+    }
+    return candidates[0];
+}
+
+bool play_game( generate_job *job, const int32_t index_of_game )
+{
+    const int16_t *decks = deal_source_decks( &job->deals, index_of_game );
+    if ( ! decks ) {
+        fprintf( stderr, "error: %d 番目のゲームの山札がありません(%d).\n", index_of_game, __LINE__ );
+        return false;
+    }
+    game_state state;
+    game_init( &state, decks, decks + k_number_of_deck, index_of_game % 2 );
+
+    // each player has the random stream of the sample player with its seed.
+    game_random randoms[2];
+    game_random_seed_stream( &randoms[0], option_seed1, (uint64_t)index_of_game );
+    game_random_seed_stream( &randoms[1], option_seed2, (uint64_t)index_of_game );
+
+    int32_t number_of_rows = 0;
+    play_action candidates[play_action_candidate_max];
+    while ( ! game_is_end( &state ) ) {
+        if ( number_of_rows == job->capacity_of_rows ) {
+            const int32_t capacity = job->capacity_of_rows ? job->capacity_of_rows * 2 : 256;
+            dataset_row *rows = realloc( job->rows, capacity * sizeof( dataset_row ) );
+            if ( ! rows ) {
+                fprintf( stderr, "error: realloc に失敗しました(%d).\n", __LINE__ );
+                return false;
+            }
+            job->rows = rows;
+            job->capacity_of_rows = capacity;
+        }
+
+        const int32_t you = game_turn_player( &state );
+        const int32_t op = 1 - you;
+        const int32_t number_of_candidates = game_legal_moves( &state, candidates );
+        const play_action action = choose_action( candidates, number_of_candidates, &randoms[you] );
+
+        dataset_row *row = &job->rows[number_of_rows++];
+        row->index_of_game = index_of_game;
+        row->turn = state.index_of_turn;
+        row->seat = you;
+        hands_sequence( &state.players[you], row->you_hands );
+        hands_sequence( &state.players[op], row->op_hands );
+        row->top_left = place_top( &state.left );
+        row->top_right = place_top( &state.right );
+        row->you_deck = number_of_deck( &state.players[you] );
+        row->op_deck = number_of_deck( &state.players[op] );
+        row->you_previous = state.previous[you];
+        row->op_previous = state.previous[op];
+        row->action = action;
+        game_play( &state, action );
+    }
+
+    int32_t points[2];
+    game_points( &state, &points[0], &points[1] );
+    job->score_p1 += points[0];
+    job->score_p2 += points[1];
+    job->number_of_games++;
+
+    // a game may continue in the next chunk.
+    for ( int32_t i = 0; i < number_of_rows; i++ ) {
+        dataset_row *row = &job->rows[i];
+        row->you_points = points[row->seat];
+        row->op_points = points[1 - row->seat];
+        dataset_encode_row( job->columns, job->number_of_positions++, row );
+        if ( job->number_of_positions == option_chunk && ! job_flush( job ) ) return false;
+    }
+    return true;
+}
+
+void *run_job( void *argument )
+{
+    generate_job *job = argument;
+    int32_t begin;
+    int32_t end;
+    while ( ! job->failed && take_games( &generate_counter, &begin, &end ) ) {
+        for ( int32_t i = begin; ! job->failed && i < end; i++ ) {
+            job->failed = ! play_game( job, i );
+        }
+    }
+    job->failed = job->failed || ! job_flush( job );
+    if ( job->failed ) {
+        // the other threads stop at their next take.
+        pthread_mutex_lock( &generate_counter.mutex );
+        generate_counter.index_of_next_game = option_number_of_games;
+        pthread_mutex_unlock( &generate_counter.mutex );
+    }
+    return NULL;
+}
+
+double generate_now( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int generate( void )
+{
+    generate_job *jobs = calloc( option_number_of_threads, sizeof( generate_job ) );
+    if ( ! jobs ) {
+        fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
+        return EXIT_FAILURE;
+    }
+    bool ready = dataset_writer_open( &generate_writer, option_output );
+    for ( int32_t i = 0; ready && i < option_number_of_threads; i++ ) {
+        ready = job_open( &jobs[i] );
+    }
+
+    const double begin = generate_now();
+    int32_t number_of_threads = 0;
+    for ( ; ready && number_of_threads < option_number_of_threads; number_of_threads++ ) {
+        if ( pthread_create( &jobs[number_of_threads].thread, NULL, run_job, &jobs[number_of_threads] ) != 0 ) {
+            fprintf( stderr, "error: pthread_create に失敗しました(%d).\n", __LINE__ );
+            ready = false;
+            break;
+        }
+    }
+    if ( ! ready ) {
+        // started threads stop at their next take.
+        pthread_mutex_lock( &generate_counter.mutex );
+        generate_counter.index_of_next_game = option_number_of_games;
+        pthread_mutex_unlock( &generate_counter.mutex );
+    }
+
+    int exit_code = ready ? EXIT_SUCCESS : EXIT_FAILURE;
+    int64_t number_of_games = 0;
+    int64_t score_p1 = 0;
+    int64_t score_p2 = 0;
+    for ( int32_t i = 0; i < number_of_threads; i++ ) {
+        pthread_join( jobs[i].thread, NULL );
+    }
+    for ( int32_t i = 0; i < option_number_of_threads; i++ ) {
+        if ( jobs[i].failed ) exit_code = EXIT_FAILURE;
+        number_of_games += jobs[i].number_of_games;
+        score_p1 += jobs[i].score_p1;
+        score_p2 += jobs[i].score_p2;
+        job_close( &jobs[i] );
+    }
+    const double seconds = generate_now() - begin;
+    const int64_t number_of_positions = generate_writer.number_of_positions;
+    const int32_t number_of_chunks = generate_writer.number_of_chunks;
+    const uint64_t bytes = generate_writer.offset + (uint64_t)number_of_chunks * 8;
+    if ( ! dataset_writer_close( &generate_writer ) ) exit_code = EXIT_FAILURE;
+    free( jobs );
+
+    fprintf( stdout, "GAMES: %lld\n", (long long)number_of_games );
+    fprintf( stdout, "POSITIONS: %lld\n", (long long)number_of_positions );
+    fprintf( stdout, "CHUNKS: %d\n", number_of_chunks );
+    fprintf( stdout, "BYTES: %llu\n", (unsigned long long)bytes );
+    fprintf( stdout, "P1 SCORE: %lld\n", (long long)score_p1 );
+    fprintf( stdout, "P2 SCORE: %lld\n", (long long)score_p2 );
+    fprintf( stdout, "POSITIONS/SEC: %.0f\n", seconds > 0 ? number_of_positions / seconds : 0.0 );
+    return exit_code;
+}
+
+// reads a dataset in place and sums it up. the points of a game are counted at its first turn.
+int read_dataset( void )
+{
+    const int fd = open( option_read, O_RDONLY );
+    if ( fd == -1 ) {
+        fprintf( stderr, "error: %s を開けませんでした(%d).\n", option_read, __LINE__ );
+        return EXIT_FAILURE;
+    }
+    struct stat status;
+    if ( fstat( fd, &status ) == -1 || status.st_size == 0 ) {
+        fprintf( stderr, "error: %s の大きさを取得できませんでした(%d).\n", option_read, __LINE__ );
+        close( fd );
+        return EXIT_FAILURE;
+    }
+    const size_t size = (size_t)status.st_size;
+    const uint8_t *data = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( data == MAP_FAILED ) {
+        fprintf( stderr, "error: mmap に失敗しました(%d).\n", __LINE__ );
+        return EXIT_FAILURE;
+    }
+
+    int exit_code = EXIT_SUCCESS;
+    dataset_header header;
+    if ( ! dataset_decode_header( data, size, &header ) ) {
+        fprintf( stderr, "error: %s はデータセットではありません(%d).\n", option_read, __LINE__ );
+        munmap( (void *)data, size );
+        return EXIT_FAILURE;
+    }
+
+    madvise( (void *)data, size, MADV_SEQUENTIAL );
+    int64_t number_of_positions = 0;
+    int64_t number_of_games = 0;
+    int64_t score_p1 = 0;
+    int64_t score_p2 = 0;
+    int32_t number_of_errors = 0;
+    dataset_chunk chunk;
+    dataset_row row;
+    for ( int32_t n = 0; n < header.number_of_chunks; n++ ) {
+        if ( ! dataset_decode_chunk( data, size, &header, n, &chunk ) ) {
+            number_of_errors++;
+            continue;
+        }
+        for ( int32_t i = 0; i < chunk.number_of_positions; i++ ) {
+            dataset_decode_row( &chunk, i, &row );
+            if ( row.turn != 0 ) continue;
+            number_of_games++;
+            score_p1 += row.seat == 0 ? row.you_points : row.op_points;
+            score_p2 += row.seat == 0 ? row.op_points : row.you_points;
+        }
+        number_of_positions += chunk.number_of_positions;
+    }
+    if ( number_of_positions != header.number_of_positions ) number_of_errors++;
+
+    fprintf( stdout, "CHUNKS: %d\n", header.number_of_chunks );
+    fprintf( stdout, "POSITIONS: %lld\n", (long long)number_of_positions );
+    fprintf( stdout, "GAMES: %lld\n", (long long)number_of_games );
+    fprintf( stdout, "ERRORS: %d\n", number_of_errors );
+    fprintf( stdout, "P1 SCORE: %lld\n", (long long)score_p1 );
+    fprintf( stdout, "P2 SCORE: %lld\n", (long long)score_p2 );
+    if ( number_of_errors > 0 ) exit_code = EXIT_FAILURE;
+
+    munmap( (void *)data, size );
+    return exit_code;
+}
+
+int main( const int argc, const char *argv[] )
+{
+    // get options.
+    option_seed = (uint64_t)time( NULL );
+    bool seed1 = false;
+    bool seed2 = false;
+    for ( int i = 1; i < argc; i++ ) {
+        if ( i+1 < argc && strcmp( argv[i], "--output" ) == 0 ) {
+            option_output = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--read" ) == 0 ) {
+            option_read = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--deals" ) == 0 ) {
+            option_deals = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--write-deals" ) == 0 ) {
+            option_write_deals = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--number" ) == 0 ) {
+            option_number_of_games = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--threads" ) == 0 ) {
+            option_number_of_threads = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--chunk" ) == 0 ) {
+            option_chunk = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--seed" ) == 0 ) {
+            option_seed = strtoull( argv[++i], NULL, 10 );
+        } else if ( i+1 < argc && strcmp( argv[i], "--seed1" ) == 0 ) {
+            option_seed1 = strtoull( argv[++i], NULL, 10 );
+            seed1 = true;
+        } else if ( i+1 < argc && strcmp( argv[i], "--seed2" ) == 0 ) {
+            option_seed2 = strtoull( argv[++i], NULL, 10 );
+            seed2 = true;
+        } else if ( strcmp( argv[i], "--version" ) == 0 ) {
+            version();
+            return EXIT_SUCCESS;
+        } else {
+            fprintf( stdout, "error: 不明な引数 %s が与えられました.\n", argv[i] );
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if ( ! seed1 ) option_seed1 = option_seed + 1;
+    if ( ! seed2 ) option_seed2 = option_seed + 2;
+    if ( option_number_of_threads == 0 ) option_number_of_threads = (int32_t)sysconf( _SC_NPROCESSORS_ONLN );
+
+    if ( option_read ) {
+        return read_dataset();
+    }
+
+    if ( option_write_deals ) {
+        if ( option_number_of_games < 0 ) {
+            fprintf( stdout, "error: 引数 --number には0以上を与えてください.\n" );
+            return EXIT_FAILURE;
+        }
+        if ( ! deal_file_write( option_write_deals, option_seed, option_number_of_games ) ) {
+            fprintf( stderr, "error: %s に山札を書き込めませんでした(%d).\n", option_write_deals, __LINE__ );
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if ( ! option_output ) {
+        fprintf( stdout, "error: 引数 --output か --read を与えてください.\n" );
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if ( option_number_of_games < 0 || option_number_of_threads < 1 || option_chunk < 1 ) {
+        fprintf( stdout, "error: 引数 --number には0以上を, --threads と --chunk には1以上を与えてください.\n" );
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if ( option_deals ) {
+        if ( ! deal_file_read( &generate_deal_file, option_deals ) ) {
+            fprintf( stderr, "error: %s を山札のファイルとして読み込めませんでした(%d).\n", option_deals, __LINE__ );
+            return EXIT_FAILURE;
+        }
+        if ( option_number_of_games > generate_deal_file.header.number_of_games ) {
+            fprintf( stdout, "error: 引数 --number には山札のファイルのゲームの数 %d 以下を与えてください.\n", generate_deal_file.header.number_of_games );
+            deal_file_free( &generate_deal_file );
+            return EXIT_FAILURE;
+        }
+    }
+
+    const int exit_code = generate();
+    deal_file_free( &generate_deal_file );
+    return exit_code;
+}
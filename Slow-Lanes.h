@@ -0,0 +1,122 @@
+#ifndef SLOW_LANES_H
+#define SLOW_LANES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Slow-Rule.h"
+
+//!
+//! 複数のゲームの同じ値を 32 ビットの要素の並びとしてまとめて計算するための型です.
+//!
+//! Slow-Batch.c と Slow-Deal.c の中だけで使います. 並びの数 SLOW_LANES はコンパイルの対象の命令セットで決まり,
+//! コンパイラのベクトル拡張で SSE2 や NEON では 4, AVX2 では 8, AVX-512 では 16 になります.
+//! ベクトル拡張が使えないコンパイラや SLOW_BATCH_SCALAR を定義した場合は 1 で, ふつうの整数として同じ計算をします.
+//!
+//! 比較は LANES_IF で真の要素のすべてのビットが立った並びにし, lanes_select で要素ごとに選びます.
+//! 1つの要素は LANE( v, l ) で読み書きします.
+//!
+
+#if defined( SLOW_BATCH_SCALAR ) || ! ( defined( __clang__ ) || ( defined( __GNUC__ ) && __GNUC__ >= 9 ) )
+#define SLOW_LANES 1
+#elif defined( __AVX512F__ )
+#define SLOW_LANES 16
+#elif defined( __AVX2__ )
+#define SLOW_LANES 8
+#else
+#define SLOW_LANES 4
+#endif
+
+#if SLOW_LANES > 1
+typedef uint32_t lanes __attribute__(( vector_size( 4 * SLOW_LANES ) ));       //!< 32 ビットの要素の並び
+typedef uint64_t lanes64 __attribute__(( vector_size( 8 * SLOW_LANES ) ));     //!< 64 ビットの要素の並び
+#define LANES_IF( condition ) ( (lanes)( condition ) )
+#define LANE( v, l ) ( (v)[l] )
+#define LANES_WIDEN( v ) __builtin_convertvector( v, lanes64 )
+#define LANES_NARROW( v ) __builtin_convertvector( v, lanes )
+#else
+typedef uint32_t lanes;
+typedef uint64_t lanes64;
+#define LANES_IF( condition ) ( (lanes)0 - (lanes)( condition ) )
+#define LANE( v, l ) ( ( &(v) )[l] )
+#define LANES_WIDEN( v ) ( (lanes64)( v ) )
+#define LANES_NARROW( v ) ( (lanes)( v ) )
+#endif
+
+//! condition の要素が真であれば a, 偽であれば b
+static inline lanes lanes_select( const lanes condition, const lanes a, const lanes b )
+{
+    return ( a & condition ) | ( b & ~condition );
+}
+
+//! 0 でない要素があるか
+static inline bool lanes_any( const lanes v )
+{
+    for ( int32_t l = 0; l < SLOW_LANES; l++ ) {
+        if ( LANE( v, l ) ) return true;
+    }
+    return false;
+}
+
+//!
+//! @brief  active の要素ごとに game_random_bounded の最初の乱数で範囲内の数を作ります
+//!
+//! bound は 65536 未満に限り, 乱数と bound の積を 32 ビットの要素だけで求めます.
+//! game_random_bounded が乱数を引き直すかもしれない要素は uncertain に立ちます. 乱数の 2^32 / bound 回に1回ほどです.
+//!
+//! @param  random      [in,out]要素ごとの game_random の state. active でない要素は進めない.
+//! @param  uncertain   [out]結果が game_random_bounded と違うかもしれない要素
+//! @param  low         [out]乱数と bound の積の下位 32 ビット
+//!
+static inline lanes lanes_random_bounded_once( lanes64 *random, const lanes bound, const lanes active, lanes *uncertain, lanes *low )
+{
+    // splitmix64, as game_random_next.
+    *random += -LANES_WIDEN( active & 1 ) & 0x9e3779b97f4a7c15ULL;
+    lanes64 z = *random;
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    z = z ^ ( z >> 31 );
+
+    // the 64 bit product of the random number and bound from 16 bit halves.
+    const lanes r = LANES_NARROW( z >> 32 );
+    const lanes upper = ( r >> 16 ) * bound;
+    const lanes lower = ( r & 0xffff ) * bound;
+    *low = ( upper << 16 ) + lower;
+    *uncertain = active & LANES_IF( *low < bound );
+    return ( upper + ( lower >> 16 ) ) >> 16;
+}
+
+//!
+//! @brief  active の要素ごとに game_random_bounded と同じ乱数を作ります
+//!
+//! bound は 65536 未満に限ります.
+//!
+//! @param  random  [in,out]要素ごとの game_random の state. active でない要素は進めない.
+//!
+static inline lanes lanes_random_bounded( lanes64 *random, const lanes bound, const lanes active )
+{
+    lanes uncertain;
+    lanes low;
+    lanes result = lanes_random_bounded_once( random, bound, active, &uncertain, &low );
+
+    // the rejection is rare, so it is done lane by lane.
+    if ( lanes_any( uncertain ) ) {
+        for ( int32_t l = 0; l < SLOW_LANES; l++ ) {
+            if ( ! LANE( uncertain, l ) ) continue;
+            const uint32_t b = LANE( bound, l );
+            const uint32_t threshold = -b % b;
+            if ( LANE( low, l ) >= threshold ) continue;
+            game_random lane_random = { LANE( *random, l ) };
+            uint64_t m;
+            do {
+                m = (uint64_t)game_random_next( &lane_random ) * b;
+            } while ( (uint32_t)m < threshold );
+            LANE( *random, l ) = lane_random.state;
+            LANE( result, l ) = (uint32_t)( m >> 32 );
+        }
+    }
+    return result;
+}
+
+#endif
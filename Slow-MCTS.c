@@ -0,0 +1,358 @@
+#include "Slow-MCTS.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+static const int32_t k_max_nodes = 1 << 16;        // nodes of a tree. a full tree only plays out.
+static const int32_t k_default_time_budget = 100;  // milliseconds when neither limit is given.
+static const int32_t k_check_interval = 64;        // playouts between looks at the clock.
+static const double k_exploration = 0.7;
+static const double k_reward_scale = 182.0;        // sum of a whole deck. points never exceed it.
+
+typedef struct {
+    play_action action;     // the action from the parent.
+    int32_t player;         // the player who took the action.
+    int32_t parent;
+    int32_t child;          // first child. -1 if none.
+    int32_t sibling;
+    int32_t visits;
+    int32_t availability;   // visits of the parent where the action was legal.
+    double reward;          // total for the player who took the action.
+} mcts_node;
+
+// a thread of the pool with its own tree. worker 0 runs on the calling thread.
+typedef struct {
+    mcts_search *search;
+    pthread_t thread;
+    bool started;
+    game_random random;
+    mcts_node *nodes;
+    int32_t number_of_nodes;
+    int64_t playouts;
+} mcts_worker;
+
+struct mcts_search {
+    mcts_config config;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_start;
+    pthread_cond_t cond_done;
+    int64_t generation;     // counts moves. workers start when it changes.
+    int32_t running;        // pool threads still searching this move.
+    bool quit;
+    mcts_worker *workers;
+
+    // the move being searched. read only while workers run.
+    game_state root;
+    int8_t unseen[2][k_number_of_ranks+1];
+    uint64_t seed;
+    int64_t deadline;       // 0 has no limit.
+    int64_t max_playouts;   // of each worker. 0 has no limit.
+};
+
+static int64_t mcts_now( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// candidates without repeats. two cards of a rank give the same action twice.
+static int32_t unique_moves( const game_state *state, play_action *candidates )
+{
+    play_action moves[play_action_candidate_max];
+    const int32_t number_of_moves = game_legal_moves( state, moves );
+    int32_t number_of_candidates = 0;
+    for ( int32_t i = 0; i < number_of_moves; i++ ) {
+        bool repeated = false;
+        for ( int32_t j = 0; j < number_of_candidates && ! repeated; j++ ) {
+            repeated = is_equals_play_action( candidates[j], moves[i] );
+        }
+        if ( ! repeated ) candidates[number_of_candidates++] = moves[i];
+    }
+    return number_of_candidates;
+}
+
+static void mcts_root( game_state *state, int8_t unseen[2][k_number_of_ranks+1], const mcts_observation *observation )
+{
+    memset( state, 0, sizeof( *state ) );
+    state->index_of_turn = observation->turn;
+    state->first = observation->turn % 2;   // so player 0 moves now.
+    state->previous[0] = observation->previous[0];
+    state->previous[1] = observation->previous[1];
+
+    for ( int32_t i = 0; i < 2; i++ ) {
+        player_cards *cards = &state->players[i];
+        for ( const int16_t *it = observation->hands[i]; *it != 0; it++ ) {
+            cards->hands[*it]++;
+            cards->hands_mask |= (uint16_t)( 1u << *it );
+            cards->number_of_hands++;
+            cards->sum += *it;
+        }
+        int32_t number_of_unseen = 0;
+        for ( int32_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+            unseen[i][rank] = observation->unseen[i][rank] > 0 ? observation->unseen[i][rank] : 0;
+            number_of_unseen += unseen[i][rank];
+            cards->sum += rank * unseen[i][rank];
+        }
+        cards->deck_top = k_number_of_deck - number_of_unseen;
+    }
+
+    // only the tops matter to the rules.
+    if ( observation->top_left != 0 ) {
+        state->left.length = 1;
+        state->left.cards[k_max_place-1] = observation->top_left;
+    }
+    if ( observation->top_right != 0 ) {
+        state->right.length = 1;
+        state->right.cards[k_max_place-1] = observation->top_right;
+    }
+}
+
+// the root with the unseen cards of both decks in a random order.
+static void determinize( mcts_worker *worker, game_state *state )
+{
+    const mcts_search *search = worker->search;
+    *state = search->root;
+    for ( int32_t i = 0; i < 2; i++ ) {
+        player_cards *cards = &state->players[i];
+        int16_t *deck = cards->deck + cards->deck_top;
+        int16_t *it = deck;
+        for ( int16_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+            for ( int32_t j = 0; j < search->unseen[i][rank]; j++ ) *(it++) = rank;
+        }
+        deck_shuffle( deck, it - deck, &worker->random );
+    }
+}
+
+static int32_t node_add( mcts_worker *worker, const int32_t parent, const play_action action, const int32_t player )
+{
+    if ( worker->number_of_nodes == k_max_nodes ) return -1;
+    const int32_t index = worker->number_of_nodes++;
+    mcts_node *node = &worker->nodes[index];
+    node->action = action;
+    node->player = player;
+    node->parent = parent;
+    node->child = -1;
+    node->sibling = -1;
+    node->visits = 0;
+    node->availability = 1;
+    node->reward = 0;
+    if ( parent >= 0 ) {
+        node->sibling = worker->nodes[parent].child;
+        worker->nodes[parent].child = index;
+    }
+    return index;
+}
+
+static int32_t node_find( const mcts_worker *worker, const int32_t parent, const play_action action )
+{
+    for ( int32_t child = worker->nodes[parent].child; child >= 0; child = worker->nodes[child].sibling ) {
+        if ( is_equals_play_action( worker->nodes[child].action, action ) ) return child;
+    }
+    return -1;
+}
+
+// random moves to the end. like the sample player, pass only when nothing else can be done.
+static void playout( game_state *state, game_random *random )
+{
+    play_action candidates[play_action_candidate_max];
+    while ( ! game_is_end( state ) ) {
+        int32_t number_of_candidates = game_legal_moves( state, candidates );
+        if ( number_of_candidates > 1 && candidates[number_of_candidates-1].operation == play_operation_pass ) number_of_candidates--;
+        game_play( state, candidates[game_random_bounded( random, (uint32_t)number_of_candidates )] );
+    }
+}
+
+static void mcts_iterate( mcts_worker *worker )
+{
+    mcts_node *nodes = worker->nodes;
+    game_state state;
+    determinize( worker, &state );
+
+    // select while every legal action has a node, then expand one.
+    int32_t node = 0;
+    while ( ! game_is_end( &state ) ) {
+        play_action candidates[play_action_candidate_max];
+        const int32_t number_of_candidates = unique_moves( &state, candidates );
+        int32_t untried[play_action_candidate_max];
+        int32_t number_of_untried = 0;
+        int32_t best = -1;
+        double best_score = 0;
+        for ( int32_t i = 0; i < number_of_candidates; i++ ) {
+            const int32_t child = node_find( worker, node, candidates[i] );
+            if ( child < 0 ) {
+                untried[number_of_untried++] = i;
+                continue;
+            }
+            nodes[child].availability++;
+            const double score = nodes[child].reward / nodes[child].visits + k_exploration * sqrt( log( nodes[child].availability ) / nodes[child].visits );
+            if ( best < 0 || score > best_score ) {
+                best = child;
+                best_score = score;
+            }
+        }
+        if ( number_of_untried > 0 ) {
+            const play_action action = candidates[untried[game_random_bounded( &worker->random, (uint32_t)number_of_untried )]];
+            const int32_t child = node_add( worker, node, action, game_turn_player( &state ) );
+            game_play( &state, action );
+            if ( child >= 0 ) node = child;
+            break;
+        }
+        game_play( &state, nodes[best].action );
+        node = best;
+    }
+
+    playout( &state, &worker->random );
+
+    int32_t points[2];
+    game_points( &state, &points[0], &points[1] );
+    for ( ; node >= 0; node = nodes[node].parent ) {
+        nodes[node].visits++;
+        nodes[node].reward += points[nodes[node].player] / k_reward_scale;
+    }
+}
+
+static void mcts_worker_search( mcts_worker *worker )
+{
+    const mcts_search *search = worker->search;
+    game_random_seed_stream( &worker->random, search->seed, (uint64_t)( worker - search->workers ) );
+    worker->number_of_nodes = 0;
+    worker->playouts = 0;
+    node_add( worker, -1, play_action_make( play_operation_null, 0 ), 1 );
+
+    for ( ;; ) {
+        if ( search->max_playouts > 0 && worker->playouts >= search->max_playouts ) break;
+        if ( search->deadline > 0 && worker->playouts % k_check_interval == 0 && worker->playouts > 0 && mcts_now() >= search->deadline ) break;
+        mcts_iterate( worker );
+        worker->playouts++;
+    }
+}
+
+static void *mcts_worker_main( void *argument )
+{
+    mcts_worker *worker = argument;
+    mcts_search *search = worker->search;
+    int64_t generation = 0;
+
+    pthread_mutex_lock( &search->mutex );
+    for ( ;; ) {
+        while ( ! search->quit && search->generation == generation ) {
+            pthread_cond_wait( &search->cond_start, &search->mutex );
+        }
+        if ( search->quit ) break;
+        generation = search->generation;
+        pthread_mutex_unlock( &search->mutex );
+
+        mcts_worker_search( worker );
+
+        pthread_mutex_lock( &search->mutex );
+        if ( --search->running == 0 ) pthread_cond_signal( &search->cond_done );
+    }
+    pthread_mutex_unlock( &search->mutex );
+    return NULL;
+}
+
+mcts_search *mcts_create( const mcts_config *config )
+{
+    mcts_search *search = calloc( 1, sizeof( mcts_search ) );
+    if ( ! search ) return NULL;
+    search->config = *config;
+    if ( search->config.number_of_threads < 1 ) search->config.number_of_threads = 1;
+    if ( search->config.time_budget <= 0 && search->config.max_playouts <= 0 ) search->config.time_budget = k_default_time_budget;
+    pthread_mutex_init( &search->mutex, NULL );
+    pthread_cond_init( &search->cond_start, NULL );
+    pthread_cond_init( &search->cond_done, NULL );
+
+    search->workers = calloc( search->config.number_of_threads, sizeof( mcts_worker ) );
+    if ( ! search->workers ) {
+        mcts_destroy( search );
+        return NULL;
+    }
+    for ( int32_t i = 0; i < search->config.number_of_threads; i++ ) {
+        mcts_worker *worker = &search->workers[i];
+        worker->search = search;
+        worker->nodes = malloc( k_max_nodes * sizeof( mcts_node ) );
+        if ( ! worker->nodes ) {
+            mcts_destroy( search );
+            return NULL;
+        }
+        if ( i > 0 ) {
+            if ( pthread_create( &worker->thread, NULL, mcts_worker_main, worker ) != 0 ) {
+                mcts_destroy( search );
+                return NULL;
+            }
+            worker->started = true;
+        }
+    }
+    return search;
+}
+
+void mcts_destroy( mcts_search *search )
+{
+    if ( ! search ) return;
+    pthread_mutex_lock( &search->mutex );
+    search->quit = true;
+    pthread_cond_broadcast( &search->cond_start );
+    pthread_mutex_unlock( &search->mutex );
+
+    for ( int32_t i = 0; search->workers && i < search->config.number_of_threads; i++ ) {
+        if ( search->workers[i].started ) pthread_join( search->workers[i].thread, NULL );
+        free( search->workers[i].nodes );
+    }
+    free( search->workers );
+    pthread_cond_destroy( &search->cond_done );
+    pthread_cond_destroy( &search->cond_start );
+    pthread_mutex_destroy( &search->mutex );
+    free( search );
+}
+
+play_action mcts_choose( mcts_search *search, const mcts_observation *observation, const uint64_t seed, mcts_statistics *statistics )
+{
+    const int64_t begin = mcts_now();
+    mcts_root( &search->root, search->unseen, observation );
+
+    play_action candidates[play_action_candidate_max];
+    const int32_t number_of_candidates = unique_moves( &search->root, candidates );
+    if ( statistics ) statistics->playouts = 0;
+
+    int32_t best = 0;
+    if ( number_of_candidates > 1 ) {
+        const int32_t number_of_threads = search->config.number_of_threads;
+        search->seed = seed;
+        search->deadline = search->config.time_budget > 0 ? begin + search->config.time_budget * 1000000LL : 0;
+        search->max_playouts = search->config.max_playouts > 0 ? ( search->config.max_playouts + number_of_threads - 1 ) / number_of_threads : 0;
+
+        // the pool shares the move, the calling thread searches as worker 0.
+        pthread_mutex_lock( &search->mutex );
+        search->generation++;
+        search->running = number_of_threads - 1;
+        pthread_cond_broadcast( &search->cond_start );
+        pthread_mutex_unlock( &search->mutex );
+        mcts_worker_search( &search->workers[0] );
+        pthread_mutex_lock( &search->mutex );
+        while ( search->running > 0 ) pthread_cond_wait( &search->cond_done, &search->mutex );
+        pthread_mutex_unlock( &search->mutex );
+
+        // the most visited action over all trees.
+        int64_t best_visits = -1;
+        for ( int32_t i = 0; i < number_of_candidates; i++ ) {
+            int64_t visits = 0;
+            for ( int32_t j = 0; j < number_of_threads; j++ ) {
+                const int32_t child = node_find( &search->workers[j], 0, candidates[i] );
+                if ( child >= 0 ) visits += search->workers[j].nodes[child].visits;
+            }
+            if ( visits > best_visits ) {
+                best = i;
+                best_visits = visits;
+            }
+        }
+        if ( statistics ) {
+            for ( int32_t j = 0; j < number_of_threads; j++ ) statistics->playouts += search->workers[j].playouts;
+        }
+    }
+    if ( statistics ) statistics->nanoseconds = mcts_now() - begin;
+    return candidates[best];
+}
@@ -0,0 +1,63 @@
+#ifndef SLOW_MCTS_H
+#define SLOW_MCTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Slow-Rule.h"
+
+//!
+//! 山札の順番を決めて探索するモンテカルロ木探索です.
+//!
+//! 隠れているのは各プレイヤーの山札の順番だけなので, 反復ごとに見えていない札を混ぜて山札を決め ( 決定化 ),
+//! 決めた山札でルールを進めて木を1つ伸ばし, 最後まで乱数で対戦します.
+//! 木は行動ごとの節で, 決定化によって選べない行動は選べた回数 ( availability ) で割り引きます.
+//!
+//! 探索はスレッドプールの各スレッドがそれぞれの木で行い, 最後に根の行動の訪問回数を合計して選びます.
+//!
+
+//! 探索の設定
+typedef struct {
+    int32_t number_of_threads;  //!< 探索するスレッドの数. 呼び出したスレッドも1つに数える.
+    int32_t time_budget;        //!< 1手の探索時間 ( ミリ秒 ). 0 は制限しない.
+    int32_t max_playouts;       //!< 1手の最大のプレイアウト数. 0 は制限しない.
+} mcts_config;
+
+//! 手番のプレイヤーから見えている局面. 自分をプレイヤー 0, 相手を 1 とする.
+typedef struct {
+    int32_t turn;
+    int16_t hands[2][k_max_hands+1];        //!< 0 終端の手札
+    int8_t unseen[2][k_number_of_ranks+1];  //!< 山札に残っている番号ごとの枚数
+    int16_t top_left;
+    int16_t top_right;
+    play_action previous[2];
+} mcts_observation;
+
+//! 探索の統計
+typedef struct {
+    int64_t playouts;
+    int64_t nanoseconds;
+} mcts_statistics;
+
+typedef struct mcts_search mcts_search;
+
+//!
+//! @brief  探索のスレッドプールを作ります
+//!
+//! @return 失敗すると NULL
+//!
+mcts_search *mcts_create( const mcts_config *config );
+
+void mcts_destroy( mcts_search *search );
+
+//!
+//! @brief  局面から行動を探索します
+//!
+//! @param  seed        [in]乱数の種. 同じ種と局面からは1スレッドでプレイアウト数を制限すれば同じ行動を返す.
+//! @param  statistics  [out]この手の統計. NULL でもよい.
+//!
+//! @return 候補の中で最も多く訪問された行動
+//!
+play_action mcts_choose( mcts_search *search, const mcts_observation *observation, const uint64_t seed, mcts_statistics *statistics );
+
+#endif
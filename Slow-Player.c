@@ -10,6 +10,9 @@
 
 #include <unistd.h>
 
+#include "Slow-Rule.h"
+#include "Slow-Protocol.h"
+
 typedef int16_t card_t;         // 札
 typedef card_t * card_array_t;  // 札の配列.
 
@@ -116,29 +119,32 @@ action_t action_make( const action_operation operation, const card_t card )
 }
 
 
-int32_t action_put_candidates( action_t *candidates, const action_operation operation, const card_array_t hands, const card_array_t place )
+//!
+//! @brief  ルールの行動を action_t に変換します
+//!
+action_t action_from_play_action( const play_action action )
 {
-    int32_t candidate_count = 0;
-    if ( card_array_is_empty( place ) ) {
-        for ( int32_t index = 0; index < card_array_count( hands ); index++ ) {
-            const card_t card = card_array_at( hands, index );
-            candidates[candidate_count] = action_make( operation, card );
-            candidate_count++;
-        }
-    } else {
-        const card_t card = card_array_top( place );
-        int16_t upper = card == 13 ? 1 : card + 1;
-        int16_t lower = card == 1 ? 13 : card - 1;
-        if ( card_array_is_member( hands, lower ) ) {
-            candidates[candidate_count] = action_make( operation, lower );
-            candidate_count++;
-        }
-        if ( card_array_is_member( hands, upper ) ) {
-            candidates[candidate_count] = action_make( operation, upper );
-            candidate_count++;
-        }
+    switch ( action.operation ) {
+        case play_operation_pass:       return action_make( action_operation_pass, 0 );
+        case play_operation_draw:       return action_make( action_operation_draw, 0 );
+        case play_operation_put_left:   return action_make( action_operation_put_left, action.card );
+        case play_operation_put_right:  return action_make( action_operation_put_right, action.card );
+        default:                        return action_make( action_operation_none, 0 );
+    }
+}
+
+//!
+//! @brief  action_t をルールの行動に変換します
+//!
+play_action action_to_play_action( const action_t action )
+{
+    switch ( action.operation ) {
+        case action_operation_pass:      return play_action_make( play_operation_pass, 0 );
+        case action_operation_draw:      return play_action_make( play_operation_draw, 0 );
+        case action_operation_put_left:  return play_action_make( play_operation_put_left, action.card );
+        case action_operation_put_right: return play_action_make( play_operation_put_right, action.card );
+        default:                         return play_action_make( play_operation_null, 0 );
     }
-    return candidate_count;
 }
 
 //!
@@ -155,36 +161,34 @@ int32_t action_put_candidates( action_t *candidates, const action_operation oper
 static const size_t k_action_candidate_max = 12;  //!< candidatesに代入されうる最大の数
 int32_t action_candidates( action_t *candidates, const card_array_t hands, const card_array_t place_left, const card_array_t place_right, const action_t previous, const int32_t count_of_draw )
 {
-    int32_t candidate_count = 0;
-    if ( previous.operation == action_operation_pass ) {
-        for ( int32_t index = 0; index < card_array_count( hands ); index++ ) {
-            const card_t card = card_array_at( hands, index );
-            candidates[candidate_count] = action_make( action_operation_put_left, card );
-            candidate_count++;
-            candidates[candidate_count] = action_make( action_operation_put_right, card );
-            candidate_count++;
-        }
-    } else {
-        candidate_count += action_put_candidates( &candidates[candidate_count], action_operation_put_left, hands, place_left );
-        candidate_count += action_put_candidates( &candidates[candidate_count], action_operation_put_right, hands, place_right );
+    // 手札を番号ごとの枚数と番号のビットにしてルールに候補を求める.
+    int8_t counts[k_number_of_ranks+1] = {};
+    uint16_t mask = 0;
+    const int32_t number_of_hands = card_array_count( hands );
+    for ( int32_t index = 0; index < number_of_hands; index++ ) {
+        const card_t card = card_array_at( hands, index );
+        counts[card]++;
+        mask |= (uint16_t)( 1u << card );
     }
     
-    if ( card_array_count( hands ) < 5 && count_of_draw < 26 ) {
-        candidates[candidate_count] = action_make( action_operation_draw, 0 );
-        candidate_count++;
-    }
-
-    if ( candidate_count == 0 || previous.operation != action_operation_pass ) {
-        candidates[candidate_count] = action_make( action_operation_pass, 0 );
-        candidate_count++;
+    play_action actions[play_action_candidate_max];
+    const int32_t top_left = card_array_is_empty( place_left ) ? 0 : card_array_top( place_left );
+    const int32_t top_right = card_array_is_empty( place_right ) ? 0 : card_array_top( place_right );
+    const bool can_draw = number_of_hands < k_max_hands && count_of_draw < k_number_of_deck;
+    const int32_t candidate_count = play_action_candidates_mask( actions, action_to_play_action( previous ), mask, counts, can_draw, top_left, top_right );
+    for ( int32_t index = 0; index < candidate_count; index++ ) {
+        candidates[index] = action_from_play_action( actions[index] );
     }
-    
     return candidate_count;
 }
 
 // 1ゲーム中に引いた札の数を数える.
 static int32_t count_of_draw = 0;
 
+// 乱数. ゲームごとに random_seed とゲームの番号から作り直す.
+static uint64_t random_seed = 0;
+static game_random player_random;
+
 
 //!
 //! @brief  1ゲーム開始時に呼び出されます
@@ -196,8 +200,8 @@ void reset( const int32_t number_of_game )
     // ここに 1 ゲームが開始される直前に行う処理を記述します.
     count_of_draw = 0;
     
-    // 乱数を初期化する.
-    srand( (int)time( NULL ) );
+    // 乱数を初期化する. 同じ種と番号のゲームでは同じ乱数列になる.
+    game_random_seed_stream( &player_random, random_seed, (uint64_t)number_of_game );
 }
 
 //!
@@ -223,7 +227,6 @@ void gameset( const int32_t you_point, const int32_t you_score, const int32_t op
 //! @param  you_previous [in]前回の自分の行動
 //! @param  op_previous  [in]前回の相手の行動
 //!
-static void action_write( const action_t action, char *line );
 action_t play( const int32_t turn, const card_array_t you_hands, const card_array_t op_hands, const card_array_t place_left, const card_array_t place_right, const action_t you_previous, const action_t op_previous )
 {
     // ここに自分のターンの処理を記述します.
@@ -239,22 +242,42 @@ action_t play( const int32_t turn, const card_array_t you_hands, const card_arra
     
     // 候補の中からランダムで実行. 但し, パス以外の行動ができるときはパスを除く.
     if ( candidate_count > 1 && candidates[candidate_count-1].operation == action_operation_pass ) {
-        return candidates[ rand() % (candidate_count-1) ];
+        return candidates[ game_random_bounded( &player_random, (uint32_t)( candidate_count-1 ) ) ];
     } else {
         return candidates[0];
     }
 }
 
 
+//!
+//! @brief  10進の整数を読みます. 前の空白は読み飛ばします.
+//!
+//! @param  it      [in,out]読む位置. 読んだ数字の後ろに進みます.
+//! @param  value   [out]読んだ整数
+//!
+//! @retval true    整数を読んだ
+//! @retval false   数字がなかった
+//!
+static bool integer_read( const char **it, int32_t *value )
+{
+    const char *line = *it;
+    while ( *line == ' ' ) line++;
+    const bool negative = *line == '-';
+    if ( negative ) line++;
+    if ( *line < '0' || *line > '9' ) return false;
+    int32_t n = 0;
+    while ( *line >= '0' && *line <= '9' ) n = n * 10 + ( *(line++) - '0' );
+    *value = negative ? -n : n;
+    *it = line;
+    return true;
+}
+
 int32_t card_array_read( card_array_t cards, const int32_t max_cards, const char *line )
 {
     card_array_t it = cards;
-    while ( it - cards < max_cards ) {
-        while ( *line != 0 && *line == ' ' ) line++;
-        if ( *line == 0 ) break;
-        if ( sscanf( line, "%hi", it ) != 1 ) break;
-        while ( *line != 0 && *line != ' ' ) line++;
-        it++;
+    int32_t card;
+    while ( it - cards < max_cards && integer_read( &line, &card ) ) {
+        *(it++) = (card_t)card;
     }
     *it = 0;
     assert( card_array_count( cards ) == (int32_t)( it - cards ) );
@@ -264,86 +287,552 @@ int32_t card_array_read( card_array_t cards, const int32_t max_cards, const char
 action_t action_read( const char *line )
 {
     action_t action = {};
-    if ( strcmp( line, "P\n" ) == 0 ) {
+    const char *it = line + 1;
+    int32_t card = 0;
+    if ( line[0] == 'P' ) {
         action.operation = action_operation_pass;
-    } else if ( strcmp( line, "D\n" ) == 0  ) {
+    } else if ( line[0] == 'D' ) {
         action.operation = action_operation_draw;
-    } else if ( strcmp( line, "\n" ) == 0 ) {
+    } else if ( line[0] == '\n' ) {
         action.operation = action_operation_none;
-    } else if ( sscanf( line, "L%hi\n", &action.card ) == 1 ) {
+    } else if ( line[0] == 'L' && integer_read( &it, &card ) ) {
         action.operation = action_operation_put_left;
-    } else if ( sscanf( line, "R%hi\n", &action.card ) == 1 ) {
+        action.card = (card_t)card;
+    } else if ( line[0] == 'R' && integer_read( &it, &card ) ) {
         action.operation = action_operation_put_right;
+        action.card = (card_t)card;
     } else {
         assert( 0 );
     }
     return action;
 }
 
-void action_write( const action_t action, char *line )
+#ifdef SLOW_PLAYER_PLUGIN
+
+// サーバーに共有ライブラリとして読み込ませる場合の入口.
+// clang -shared -fPIC -DSLOW_PLAYER_PLUGIN Slow-Player.c Slow-Rule.c -o Slow-Player.so
+
+#include "Slow-Plugin.h"
+
+static action_t plugin_action_to_action( const slow_plugin_action action )
+{
+    return action_make( (action_operation)action.operation, (card_t)action.card );
+}
+
+static void plugin_reset( const int32_t number_of_game )
+{
+    reset( number_of_game );
+}
+
+static slow_plugin_action plugin_play( const int32_t turn, const int16_t *you_hands, const int16_t *op_hands, const int16_t *place_left, const int16_t *place_right, const slow_plugin_action you_previous, const slow_plugin_action op_previous )
+{
+    const action_t action = play( turn, (card_array_t)you_hands, (card_array_t)op_hands, (card_array_t)place_left, (card_array_t)place_right, plugin_action_to_action( you_previous ), plugin_action_to_action( op_previous ) );
+    const slow_plugin_action result = { action.operation, action.card };
+    return result;
+}
+
+static void plugin_gameset( const int32_t you_point, const int32_t you_score, const int32_t op_point, const int32_t op_score )
+{
+    gameset( you_point, you_score, op_point, op_score );
+}
+
+const slow_plugin *slow_plugin_entry( const int32_t version )
+{
+    static const slow_plugin plugin = { SLOW_PLUGIN_VERSION, plugin_reset, plugin_play, plugin_gameset };
+    random_seed = (uint64_t)time( NULL );
+    return version == SLOW_PLUGIN_VERSION ? &plugin : NULL;
+}
+
+#else
+
+#include <errno.h>
+
+#include "Slow-MCTS.h"
+#include "Slow-Solver.h"
+#include "Slow-Shm.h"
+
+// --mcts で使う探索. NULL ならば play() で行動を選ぶ.
+static mcts_search *search = NULL;
+static mcts_statistics search_total = {};
+static int32_t search_moves = 0;
+
+// --endgame で使う置換表. 両方の山札の残りが solver_unseen 枚以下ならば探索の代わりに読み切る.
+static solver_table *solver = NULL;
+static int32_t solver_unseen = 0;
+static int64_t solver_nodes = 0;
+static int64_t solver_nanoseconds = 0;
+static int32_t solver_moves = 0;
+
+// プレイヤーごとに場に出した番号ごとの枚数. 山札に残る札はこれと手札から分かる.
+static int8_t put_counts[2][k_number_of_ranks+1] = {};
+
+//!
+//! @brief  見えていない山札の順番を決めて探索し, 行動を選びます
+//!
+//! --endgame が与えられて両方の山札の残りがその枚数以下ならば, 探索せずに読み切ります.
+//! 探索も読み切りもできない場合は play() で選びます.
+//! 引数は play() と同じです.
+//!
+action_t play_search( const int32_t turn, const card_array_t you_hands, const card_array_t op_hands, const card_array_t place_left, const card_array_t place_right, const action_t you_previous, const action_t op_previous )
+{
+    // 各プレイヤーの最初の手番で数え直す. 前回の行動はそれぞれ1回ずつ届く.
+    if ( turn < 2 ) memset( put_counts, 0, sizeof( put_counts ) );
+    const action_t previous[2] = { you_previous, op_previous };
+    for ( int32_t i = 0; i < 2; i++ ) {
+        if ( previous[i].operation == action_operation_put_left || previous[i].operation == action_operation_put_right ) {
+            put_counts[i][previous[i].card]++;
+        }
+    }
+    
+    mcts_observation observation = {};
+    observation.turn = turn;
+    observation.top_left = card_array_is_empty( place_left ) ? 0 : card_array_top( place_left );
+    observation.top_right = card_array_is_empty( place_right ) ? 0 : card_array_top( place_right );
+    const card_array_t hands[2] = { you_hands, op_hands };
+    int32_t number_of_unseen = 0;
+    for ( int32_t i = 0; i < 2; i++ ) {
+        observation.previous[i] = action_to_play_action( previous[i] );
+        for ( int32_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+            observation.unseen[i][rank] = 2 - put_counts[i][rank];
+        }
+        const int32_t count = card_array_count( hands[i] );
+        for ( int32_t index = 0; index < count && index < k_max_hands; index++ ) {
+            observation.hands[i][index] = card_array_at( hands[i], index );
+            observation.unseen[i][card_array_at( hands[i], index )]--;
+        }
+        for ( int32_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+            number_of_unseen += observation.unseen[i][rank];
+        }
+    }
+    
+    if ( solver && number_of_unseen <= solver_unseen ) {
+        struct timespec begin;
+        struct timespec end;
+        clock_gettime( CLOCK_MONOTONIC, &begin );
+        solver_result result;
+        const bool solved = solver_solve( solver, observation.hands[0], observation.hands[1], observation.unseen, observation.top_left, observation.top_right, observation.previous, &result );
+        clock_gettime( CLOCK_MONOTONIC, &end );
+        if ( solved ) {
+            solver_nodes += result.nodes;
+            solver_nanoseconds += ( end.tv_sec - begin.tv_sec ) * 1000000000LL + ( end.tv_nsec - begin.tv_nsec );
+            solver_moves++;
+            return action_from_play_action( result.action );
+        }
+    }
+    if ( ! search ) return play( turn, you_hands, op_hands, place_left, place_right, you_previous, op_previous );
+    
+    // 乱数はゲームごとの乱数列から取るので, --seed と --playouts を与えて1スレッドならば再現できる.
+    const uint64_t seed = ( (uint64_t)game_random_next( &player_random ) << 32 ) | game_random_next( &player_random );
+    mcts_statistics statistics;
+    const play_action action = mcts_choose( search, &observation, seed, &statistics );
+    search_total.playouts += statistics.playouts;
+    search_total.nanoseconds += statistics.nanoseconds;
+    search_moves++;
+    return action_from_play_action( action );
+}
+
+// サーバーが --batch で同時に進めるゲームごとの状態. 手番のゲームの状態を上のグローバル変数に入れて play() を呼ぶ.
+typedef struct {
+    bool used;
+    int32_t number_of_game;
+    int32_t count_of_draw;
+    game_random random;
+    int8_t put_counts[2][k_number_of_ranks+1];
+} game_context;
+static game_context contexts[k_protocol_max_batch] = {};
+static game_context *context = NULL;   // 今のグローバル変数の状態を持つゲーム
+
+//!
+//! @brief  グローバル変数の状態を今のゲームに戻し, next の状態に入れ替えます
+//!
+static void context_switch( game_context *next )
+{
+    if ( context == next ) return;
+    if ( context ) {
+        context->count_of_draw = count_of_draw;
+        context->random = player_random;
+        memcpy( context->put_counts, put_counts, sizeof( put_counts ) );
+    }
+    if ( next ) {
+        count_of_draw = next->count_of_draw;
+        player_random = next->random;
+        memcpy( put_counts, next->put_counts, sizeof( put_counts ) );
+    }
+    context = next;
+}
+
+//!
+//! @brief  ゲームの状態を探します
+//!
+//! @return 見つからなければ NULL
+//!
+static game_context *context_find( const int32_t number_of_game )
+{
+    for ( int32_t i = 0; i < k_protocol_max_batch; i++ ) {
+        if ( contexts[i].used && contexts[i].number_of_game == number_of_game ) return &contexts[i];
+    }
+    return NULL;
+}
+
+//!
+//! @brief  空いている状態をゲームに割り当てて reset() を呼びます
+//!
+//! @retval false   同時に進むゲームが多すぎる
+//!
+static bool context_reset( const int32_t number_of_game )
+{
+    game_context *next = context_find( number_of_game );
+    for ( int32_t i = 0; ! next && i < k_protocol_max_batch; i++ ) {
+        if ( ! contexts[i].used ) next = &contexts[i];
+    }
+    if ( ! next ) return false;
+    context_switch( next );
+    next->used = true;
+    next->number_of_game = number_of_game;
+    reset( number_of_game );
+    return true;
+}
+
+//!
+//! @brief  今のゲームを終えて状態を空けます
+//!
+static void context_gameset( const int32_t you_point, const int32_t you_score, const int32_t op_point, const int32_t op_score )
+{
+    gameset( you_point, you_score, op_point, op_score );
+    if ( context ) context->used = false;
+    context = NULL;
+}
+
+// サーバーが --transport shm で渡した共有メモリ. 最初の RESET で選ぶと, それ以降は標準入出力の代わりに使う.
+static shm_channel *shm = NULL;
+
+// 標準入力のバッファ. read() でまとめて読み, メッセージを1行ずつ取り出す.
+static char input_buffer[4096];
+static size_t input_begin = 0;
+static size_t input_end = 0;
+
+// バイナリのプロトコルの応答のバッファ. 入力を待つ前にまとめて書くので, 1つのメッセージの応答は1回で返る.
+static uint8_t output_buffer[4096];
+static size_t output_length = 0;
+
+static bool output_write( const void *bytes, size_t size );
+
+//!
+//! @brief  標準入力をバッファに読み足します
+//!
+//! @retval false   入力が終わったかバッファが一杯
+//!
+static bool input_fill( void )
+{
+    if ( input_begin > 0 ) {
+        memmove( input_buffer, input_buffer + input_begin, input_end - input_begin );
+        input_end -= input_begin;
+        input_begin = 0;
+    }
+    if ( input_end == sizeof( input_buffer ) ) return false;
+    if ( output_length > 0 ) {
+        const size_t length = output_length;
+        output_length = 0;
+        if ( ! output_write( output_buffer, length ) ) return false;
+    }
+    
+    ssize_t bytes;
+    if ( shm ) {
+        // 標準入力はサーバーがいなくなったことを知るために使う.
+        bytes = shm_ring_read( &shm->to_player, input_buffer + input_end, sizeof( input_buffer ) - input_end, 0, STDIN_FILENO );
+    } else {
+        do {
+            bytes = read( STDIN_FILENO, input_buffer + input_end, sizeof( input_buffer ) - input_end );
+        } while ( bytes == -1 && errno == EINTR );
+    }
+    if ( bytes <= 0 ) return false;
+    input_end += bytes;
+    return true;
+}
+
+//!
+//! @brief  標準入力から1行を取り出します
+//!
+//! @return 改行で終わる行の先頭. 入力が終わると NULL
+//!
+//! @note   行はバッファの中を指すので, 次に読むまでに使い終えてください.
+//!
+static const char *input_line( void )
+{
+    for ( size_t scanned = input_begin; ; ) {
+        const char *lineend = memchr( input_buffer + scanned, '\n', input_end - scanned );
+        if ( lineend ) {
+            const char *line = input_buffer + input_begin;
+            input_begin = lineend - input_buffer + 1;
+            return line;
+        }
+        scanned = input_end - input_begin;
+        if ( ! input_fill() ) return NULL;
+    }
+}
+
+//!
+//! @brief  標準入力から size バイトを取り出します
+//!
+//! @retval false   入力が終わった
+//!
+static bool input_bytes( uint8_t *bytes, const size_t size )
+{
+    while ( input_end - input_begin < size ) {
+        if ( ! input_fill() ) return false;
+    }
+    memcpy( bytes, input_buffer + input_begin, size );
+    input_begin += size;
+    return true;
+}
+
+//!
+//! @brief  行が text と一致するか. text は改行で終わります.
+//!
+static bool line_equals( const char *line, const char *text )
+{
+    while ( *text != 0 && *line == *text ) {
+        line++;
+        text++;
+    }
+    return *text == 0;
+}
+
+//!
+//! @brief  応答を1回の write() で標準出力に書きます. 共有メモリを選んでいれば共有メモリに書きます.
+//!
+//! @retval false   書き込めなかった
+//!
+static bool output_write( const void *bytes, size_t size )
+{
+    if ( shm ) return shm_ring_write( &shm->to_server, bytes, size, STDOUT_FILENO );
+    
+    const char *it = bytes;
+    while ( size > 0 ) {
+        const ssize_t written = write( STDOUT_FILENO, it, size );
+        if ( written == -1 && errno == EINTR ) continue;
+        if ( written <= 0 ) return false;
+        it += written;
+        size -= written;
+    }
+    return true;
+}
+
+//!
+//! @brief  行動を応答の1行として書きます
+//!
+//! @return 改行を含むバイト数
+//!
+static int32_t action_write( const action_t action, char *line )
 {
+    char *it = line;
     if ( action.operation == action_operation_pass ) {
-        strcpy( line, "P\n" );
+        *(it++) = 'P';
     } else if ( action.operation == action_operation_draw ) {
-        strcpy( line, "D\n" );
-    } else if ( action.operation == action_operation_put_left ) {
-        sprintf( line, "L%d\n", action.card );
-    } else if ( action.operation == action_operation_put_right ) {
-        sprintf( line, "R%d\n", action.card );
+        *(it++) = 'D';
+    } else if ( action.operation == action_operation_put_left || action.operation == action_operation_put_right ) {
+        *(it++) = action.operation == action_operation_put_left ? 'L' : 'R';
+        if ( action.card >= 10 ) *(it++) = (char)( '0' + action.card / 10 );
+        *(it++) = (char)( '0' + action.card % 10 );
     } else {
         assert( 0 );
     }
+    *(it++) = '\n';
+    *it = 0;
+    return (int32_t)( it - line );
+}
+
+//!
+//! @brief  探索の統計を表示して終了します
+//!
+//! @return 終了コード
+//!
+int finish( void )
+{
+    if ( search ) {
+        const double seconds = search_total.nanoseconds * 1e-9;
+        fprintf( stderr, "MCTS: MOVES %d PLAYOUTS %lld PLAYOUTS/SEC %.0f\n", search_moves, (long long)search_total.playouts, seconds > 0 ? search_total.playouts / seconds : 0.0 );
+        mcts_destroy( search );
+        search = NULL;
+    }
+    if ( solver ) {
+        fprintf( stderr, "SOLVER: MOVES %d NODES %lld MICROSECONDS/MOVE %.1f\n", solver_moves, (long long)solver_nodes, solver_moves > 0 ? solver_nanoseconds * 1e-3 / solver_moves : 0.0 );
+        solver_destroy( solver );
+        solver = NULL;
+    }
+    fprintf( stderr, "END\n" );
+    return 0;
+}
+
+//!
+//! @brief  PLAY のフレームの局面で行動を選びます
+//!
+//! @return 応答の1バイト
+//!
+static uint8_t play_frame( const protocol_play *message )
+{
+    // 場は一番上の札だけが送られる.
+    card_t place_left[2] = { message->top_left, 0 };
+    card_t place_right[2] = { message->top_right, 0 };
+    const action_t action = ( search || solver ? play_search : play )( message->turn, (card_array_t)message->you_hands, (card_array_t)message->op_hands, place_left, place_right, action_from_play_action( message->you_previous ), action_from_play_action( message->op_previous ) );
+    return protocol_encode_action( action_to_play_action( action ) );
+}
+
+//!
+//! @brief  バイナリのプロトコルでサーバーとやり取りします
+//!
+//! @return 終了コード
+//!
+//! @note   応答は output_buffer に溜め, 次に入力を待つ前に書きます.
+//!
+int run_binary( void )
+{
+    uint8_t frame[k_protocol_batch_play_entry_size];
+    bool running = true;
+    while ( running && input_bytes( frame, 1 ) ) {
+        const uint8_t type = frame[0];
+        if ( type == protocol_message_reset ) {
+            if ( ! input_bytes( frame, k_protocol_reset_size - 1 ) ) break;
+            if ( ! context_reset( protocol_decode_reset( frame ) ) ) break;
+            output_buffer[output_length++] = type;
+        } else if ( type == protocol_message_gameset ) {
+            if ( ! input_bytes( frame, k_protocol_gameset_size - 1 ) ) break;
+            protocol_gameset message;
+            protocol_decode_gameset( frame, &message );
+            context_gameset( message.you_point, message.you_score, message.op_point, message.op_score );
+            output_buffer[output_length++] = type;
+        } else if ( type == protocol_message_batch_gameset ) {
+            if ( ! input_bytes( frame, k_protocol_batch_gameset_size - 1 ) ) break;
+            protocol_gameset message;
+            context_switch( context_find( protocol_decode_batch_gameset( frame, &message ) ) );
+            context_gameset( message.you_point, message.you_score, message.op_point, message.op_score );
+            output_buffer[output_length++] = type;
+        } else if ( type == protocol_message_play ) {
+            if ( ! input_bytes( frame, k_protocol_play_size - 1 ) ) break;
+            protocol_play message;
+            protocol_decode_play( frame, &message );
+            output_buffer[output_length++] = play_frame( &message );
+        } else if ( type == protocol_message_batch_play ) {
+            // 局面ごとにそのゲームの状態に入れ替えて選ぶ.
+            if ( ! input_bytes( frame, k_protocol_batch_play_header_size - 1 ) ) break;
+            const int32_t count = protocol_decode_batch_play_header( frame );
+            for ( int32_t i = 0; running && i < count; i++ ) {
+                running = input_bytes( frame, k_protocol_batch_play_entry_size );
+                if ( ! running ) break;
+                protocol_play message;
+                context_switch( context_find( protocol_decode_batch_play_entry( frame, &message ) ) );
+                output_buffer[output_length++] = play_frame( &message );
+            }
+        } else {
+            assert( 0 );
+            break;
+        }
+        // 溜めた応答がバッファに収まらなくなる前に書く. 1つのフレームの応答は count の最大の 255 バイトまで.
+        if ( output_length + UINT8_MAX >= sizeof( output_buffer ) ) {
+            const size_t length = output_length;
+            output_length = 0;
+            if ( ! output_write( output_buffer, length ) ) break;
+        }
+    }
+    return finish();
 }
 
 int main( const int argc, const char *argv[] )
 {
-    char line[256];
-    while ( fgets( line, sizeof(line), stdin ) ) {
-        if ( strcmp( line, "RESET\n" ) == 0 ) {
-            int32_t number_of_game;
-            fgets( line, sizeof(line), stdin );
-            sscanf( line, "%d\n", &number_of_game );
-            reset( number_of_game );
-            fprintf( stdout, "\n" );
-            fflush( stdout );
-        } else if ( strcmp( line, "GAMESET\n" ) == 0 ) {
-            int32_t you_point, you_score, op_point, op_score;
-            fgets( line, sizeof(line), stdin );
-            sscanf( line, "%d %d\n", &you_point, &you_score );
-            fgets( line, sizeof(line), stdin );
-            sscanf( line, "%d %d\n", &op_point, &op_score );
-            gameset( you_point, you_score, op_point, op_score);
-            fprintf( stdout, "\n" );
-            fflush( stdout );
-        } else if ( strcmp( line, "PLAY\n" ) == 0 ) {
-            int32_t turn;
-            card_t you_hands[6] ={}, op_hands[6] = {}, place_left[53] = {}, place_right[53] = {};
+    // --binary が与えられた場合は最初の RESET でバイナリのプロトコルを選ぶ.
+    // --seed が与えられた場合はその種で乱数を作る. 省略すると現在時刻.
+    // --mcts が与えられた場合は探索で行動を選ぶ. --threads, --move-time ( ミリ秒 ), --playouts で探索を制限する.
+    // --endgame が与えられた場合は両方の山札の残りが与えた枚数以下になると最後まで読み切る.
+    bool binary = false;
+    bool mcts = false;
+    bool endgame = false;
+    mcts_config config = { (int32_t)sysconf( _SC_NPROCESSORS_ONLN ), 0, 0 };
+    random_seed = (uint64_t)time( NULL );
+    for ( int i = 1; i < argc; i++ ) {
+        if ( strcmp( argv[i], "--binary" ) == 0 ) binary = true;
+        if ( strcmp( argv[i], "--mcts" ) == 0 ) mcts = true;
+        if ( i+1 < argc && strcmp( argv[i], "--seed" ) == 0 ) random_seed = strtoull( argv[++i], NULL, 10 );
+        if ( i+1 < argc && strcmp( argv[i], "--threads" ) == 0 ) config.number_of_threads = atoi( argv[++i] );
+        if ( i+1 < argc && strcmp( argv[i], "--move-time" ) == 0 ) config.time_budget = atoi( argv[++i] );
+        if ( i+1 < argc && strcmp( argv[i], "--playouts" ) == 0 ) config.max_playouts = atoi( argv[++i] );
+        if ( i+1 < argc && strcmp( argv[i], "--endgame" ) == 0 ) {
+            endgame = true;
+            solver_unseen = atoi( argv[++i] );
+        }
+    }
+    if ( mcts && ! ( search = mcts_create( &config ) ) ) {
+        fprintf( stderr, "error: 探索のスレッドを作れませんでした(%d).\n", __LINE__ );
+        return 1;
+    }
+    if ( endgame && ( solver_unseen < 0 || solver_unseen > k_solver_max_unseen ) ) {
+        fprintf( stderr, "error: --endgame は 0 から %d までです(%d).\n", k_solver_max_unseen, __LINE__ );
+        return 1;
+    }
+    if ( endgame && ! ( solver = solver_create( 20 ) ) ) {
+        fprintf( stderr, "error: 置換表を作れませんでした(%d).\n", __LINE__ );
+        return 1;
+    }
+    
+    // サーバーが共有メモリを渡していれば, 最初の RESET でそれを選ぶ.
+    shm_channel *offered = shm_attach();
+    
+    // メッセージは行ごとにバッファの中で数字を読み, 応答は1回の write() で返す.
+    const char *line;
+    while ( ( line = input_line() ) ) {
+        if ( line_equals( line, "RESET\n" ) ) {
+            int32_t number_of_game = 0;
+            if ( ! ( line = input_line() ) ) break;
+            integer_read( &line, &number_of_game );
+            context_reset( number_of_game );
+            if ( offered ) {
+                if ( ! output_write( SLOW_PROTOCOL_SHM "\n", sizeof( SLOW_PROTOCOL_SHM "\n" ) - 1 ) ) break;
+                shm = offered;
+                return run_binary();
+            }
+            if ( binary ) {
+                if ( ! output_write( SLOW_PROTOCOL_BINARY "\n", sizeof( SLOW_PROTOCOL_BINARY "\n" ) - 1 ) ) break;
+                return run_binary();
+            }
+            if ( ! output_write( "\n", 1 ) ) break;
+        } else if ( line_equals( line, "GAMESET\n" ) ) {
+            int32_t you_point = 0, you_score = 0, op_point = 0, op_score = 0;
+            if ( ! ( line = input_line() ) ) break;
+            integer_read( &line, &you_point );
+            integer_read( &line, &you_score );
+            if ( ! ( line = input_line() ) ) break;
+            integer_read( &line, &op_point );
+            integer_read( &line, &op_score );
+            context_gameset( you_point, you_score, op_point, op_score );
+            if ( ! output_write( "\n", 1 ) ) break;
+        } else if ( line_equals( line, "PLAY\n" ) ) {
+            int32_t turn = 0;
+            card_t you_hands[6] = {}, op_hands[6] = {}, place_left[53] = {}, place_right[53] = {};
             action_t you_previous, op_previous;
-            fgets( line, sizeof(line), stdin );
-            sscanf( line, "%d\n", &turn );
-            fgets( line, sizeof(line), stdin );
-            card_array_read( you_hands, sizeof(you_hands)/sizeof(you_hands[0]), line );
-            fgets( line, sizeof(line), stdin );
-            card_array_read( op_hands, sizeof(op_hands)/sizeof(op_hands[0]), line );
-            fgets( line, sizeof(line), stdin );
-            card_array_read( place_left, sizeof(place_left)/sizeof(place_left[0]), line );
-            fgets( line, sizeof(line), stdin );
-            card_array_read( place_right, sizeof(place_right)/sizeof(place_right[0]), line );
-            fgets( line, sizeof(line), stdin );
+            if ( ! ( line = input_line() ) ) break;
+            integer_read( &line, &turn );
+            if ( ! ( line = input_line() ) ) break;
+            card_array_read( you_hands, sizeof(you_hands)/sizeof(you_hands[0]) - 1, line );
+            if ( ! ( line = input_line() ) ) break;
+            card_array_read( op_hands, sizeof(op_hands)/sizeof(op_hands[0]) - 1, line );
+            if ( ! ( line = input_line() ) ) break;
+            card_array_read( place_left, sizeof(place_left)/sizeof(place_left[0]) - 1, line );
+            if ( ! ( line = input_line() ) ) break;
+            card_array_read( place_right, sizeof(place_right)/sizeof(place_right[0]) - 1, line );
+            if ( ! ( line = input_line() ) ) break;
             you_previous = action_read( line );
-            fgets( line, sizeof(line), stdin );
+            if ( ! ( line = input_line() ) ) break;
             op_previous = action_read( line );
-            const action_t action = play( turn, you_hands, op_hands, place_left, place_right, you_previous, op_previous );
-            action_write( action, line );
-            fprintf( stdout, "%s", line );
-            fflush( stdout );
-        } else if ( strcmp( line, "QUIT\n" ) == 0 ) {
+            const action_t action = ( search || solver ? play_search : play )( turn, you_hands, op_hands, place_left, place_right, you_previous, op_previous );
+            char reply[8];
+            if ( ! output_write( reply, action_write( action, reply ) ) ) break;
+        } else if ( line_equals( line, "QUIT\n" ) ) {
             break;
         } else {
             assert( 0 );
             break;
         }
     }
-    fprintf( stderr, "END\n" );
-    return 0;
+    return finish();
 }
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SLOW_PLUGIN_H
+#define SLOW_PLUGIN_H
+
+#include <stdint.h>
+
+//!
+//! プレイヤーを共有ライブラリとしてサーバーに読み込ませるための C ABI です.
+//!
+//! 共有ライブラリは SLOW_PLUGIN_ENTRY の名前で slow_plugin_entry_function 型の関数を公開します.
+//! サーバーはその関数に SLOW_PLUGIN_VERSION を渡し, 同じバージョンの slow_plugin を受け取ります.
+//! 札の配列は 0 終端の int16_t の配列で, パイプでやり取りする PLAY メッセージと同じ並びです.
+//!
+
+#define SLOW_PLUGIN_VERSION 1                   //!< ABI のバージョン
+#define SLOW_PLUGIN_ENTRY   "slow_plugin_entry" //!< 公開する関数の名前
+
+//! 行動の種類 ( Slow-Player.c の action_operation と同じ値 )
+enum {
+    slow_plugin_operation_none      = 0,    //!< 行動なし
+    slow_plugin_operation_pass      = 1,    //!< パス
+    slow_plugin_operation_draw      = 2,    //!< 山札から1枚引く
+    slow_plugin_operation_put_left  = 3,    //!< 場の左に札を1枚出す
+    slow_plugin_operation_put_right = 4     //!< 場の右に札を1枚出す
+};
+
+typedef struct {
+    int32_t operation;  //!< 行動
+    int32_t card;       //!< 場に出した場合の札の番号
+} slow_plugin_action;
+
+typedef struct {
+    int32_t version;    //!< SLOW_PLUGIN_VERSION
+
+    //! 1ゲーム開始時に呼び出されます
+    void (*reset)( int32_t number_of_game );
+
+    //! 自分のターンに呼び出されます
+    slow_plugin_action (*play)( int32_t turn, const int16_t *you_hands, const int16_t *op_hands, const int16_t *place_left, const int16_t *place_right, slow_plugin_action you_previous, slow_plugin_action op_previous );
+
+    //! 1ゲーム終了時に呼び出されます
+    void (*gameset)( int32_t you_point, int32_t you_score, int32_t op_point, int32_t op_score );
+} slow_plugin;
+
+//! サーバーが要求するバージョンを受け取り, 対応していなければ NULL を返します
+typedef const slow_plugin *(*slow_plugin_entry_function)( int32_t version );
+
+#endif
@@ -0,0 +1,145 @@
+#include "Slow-Protocol.h"
+
+uint8_t protocol_encode_action( const play_action action )
+{
+    switch ( action.operation ) {
+        case play_operation_pass:       return 1 << 4;
+        case play_operation_draw:       return 2 << 4;
+        case play_operation_put_left:   return (uint8_t)( ( 3 << 4 ) | ( action.card & 0x0f ) );
+        case play_operation_put_right:  return (uint8_t)( ( 4 << 4 ) | ( action.card & 0x0f ) );
+        default:                        return 0;
+    }
+}
+
+play_action protocol_decode_action( const uint8_t byte )
+{
+    const int16_t card = byte & 0x0f;
+    switch ( byte >> 4 ) {
+        case 0:  return play_action_make( play_operation_null, 0 );
+        case 1:  return play_action_make( play_operation_pass, 0 );
+        case 2:  return play_action_make( play_operation_draw, 0 );
+        case 3:  return play_action_make( play_operation_put_left, card );
+        case 4:  return play_action_make( play_operation_put_right, card );
+        default: return play_action_make( play_operation_invalid, card );
+    }
+}
+
+size_t protocol_encode_reset( uint8_t *frame, const int32_t index_of_game )
+{
+    frame[0] = protocol_message_reset;
+    put_uint32( frame + 1, (uint32_t)index_of_game );
+    return k_protocol_reset_size;
+}
+
+static void encode_hands( uint8_t *it, const int16_t *hands )
+{
+    for ( int32_t i = 0; i < k_max_hands; i++ ) {
+        it[i] = (uint8_t)*hands;
+        if ( *hands != 0 ) hands++;
+    }
+}
+
+// the body of PLAY, also an entry of BATCHPLAY after its game.
+static void encode_play_body( uint8_t *it, const int32_t turn, const int16_t *you_hands, const int16_t *op_hands, const int16_t top_left, const int16_t top_right, const play_action you_previous, const play_action op_previous )
+{
+    put_uint16( it, (uint16_t)turn );
+    encode_hands( it + 2, you_hands );
+    encode_hands( it + 7, op_hands );
+    it[12] = (uint8_t)top_left;
+    it[13] = (uint8_t)top_right;
+    it[14] = protocol_encode_action( you_previous );
+    it[15] = protocol_encode_action( op_previous );
+}
+
+size_t protocol_encode_play( uint8_t *frame, const int32_t turn, const int16_t *you_hands, const int16_t *op_hands, const int16_t top_left, const int16_t top_right, const play_action you_previous, const play_action op_previous )
+{
+    frame[0] = protocol_message_play;
+    encode_play_body( frame + 1, turn, you_hands, op_hands, top_left, top_right, you_previous, op_previous );
+    return k_protocol_play_size;
+}
+
+static void encode_gameset_body( uint8_t *it, const int32_t you_point, const int32_t op_point, const int32_t you_score, const int32_t op_score )
+{
+    put_uint16( it, (uint16_t)you_point );
+    put_uint16( it + 2, (uint16_t)op_point );
+    put_uint32( it + 4, (uint32_t)you_score );
+    put_uint32( it + 8, (uint32_t)op_score );
+}
+
+size_t protocol_encode_gameset( uint8_t *frame, const int32_t you_point, const int32_t op_point, const int32_t you_score, const int32_t op_score )
+{
+    frame[0] = protocol_message_gameset;
+    encode_gameset_body( frame + 1, you_point, op_point, you_score, op_score );
+    return k_protocol_gameset_size;
+}
+
+size_t protocol_encode_batch_play_header( uint8_t *frame, const int32_t count )
+{
+    frame[0] = protocol_message_batch_play;
+    frame[1] = (uint8_t)count;
+    return k_protocol_batch_play_header_size;
+}
+
+size_t protocol_encode_batch_play_entry( uint8_t *entry, const int32_t index_of_game, const int32_t turn, const int16_t *you_hands, const int16_t *op_hands, const int16_t top_left, const int16_t top_right, const play_action you_previous, const play_action op_previous )
+{
+    put_uint32( entry, (uint32_t)index_of_game );
+    encode_play_body( entry + 4, turn, you_hands, op_hands, top_left, top_right, you_previous, op_previous );
+    return k_protocol_batch_play_entry_size;
+}
+
+size_t protocol_encode_batch_gameset( uint8_t *frame, const int32_t index_of_game, const int32_t you_point, const int32_t op_point, const int32_t you_score, const int32_t op_score )
+{
+    frame[0] = protocol_message_batch_gameset;
+    put_uint32( frame + 1, (uint32_t)index_of_game );
+    encode_gameset_body( frame + 5, you_point, op_point, you_score, op_score );
+    return k_protocol_batch_gameset_size;
+}
+
+int32_t protocol_decode_reset( const uint8_t *body )
+{
+    return (int32_t)get_uint32( body );
+}
+
+static void decode_hands( const uint8_t *it, int16_t *hands )
+{
+    for ( int32_t i = 0; i < k_max_hands && it[i] != 0; i++ ) {
+        *(hands++) = it[i];
+    }
+    *hands = 0;
+}
+
+void protocol_decode_play( const uint8_t *body, protocol_play *play )
+{
+    play->turn = get_uint16( body );
+    decode_hands( body + 2, play->you_hands );
+    decode_hands( body + 7, play->op_hands );
+    play->top_left = body[12];
+    play->top_right = body[13];
+    play->you_previous = protocol_decode_action( body[14] );
+    play->op_previous = protocol_decode_action( body[15] );
+}
+
+void protocol_decode_gameset( const uint8_t *body, protocol_gameset *gameset )
+{
+    gameset->you_point = (int16_t)get_uint16( body );
+    gameset->op_point = (int16_t)get_uint16( body + 2 );
+    gameset->you_score = (int32_t)get_uint32( body + 4 );
+    gameset->op_score = (int32_t)get_uint32( body + 8 );
+}
+
+int32_t protocol_decode_batch_play_header( const uint8_t *body )
+{
+    return body[0];
+}
+
+int32_t protocol_decode_batch_play_entry( const uint8_t *entry, protocol_play *play )
+{
+    protocol_decode_play( entry + 4, play );
+    return (int32_t)get_uint32( entry );
+}
+
+int32_t protocol_decode_batch_gameset( const uint8_t *body, protocol_gameset *gameset )
+{
+    protocol_decode_gameset( body + 4, gameset );
+    return (int32_t)get_uint32( body );
+}
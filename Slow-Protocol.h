@@ -0,0 +1,130 @@
+#ifndef SLOW_PROTOCOL_H
+#define SLOW_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Slow-Rule.h"
+
+//!
+//! サーバーとプレイヤーの間のバイナリのプロトコルです.
+//!
+//! 最初の RESET に対してプレイヤーが空行の代わりに "BINARY" を返すと,
+//! それ以降のメッセージはすべて固定長のリトルエンディアンのフレームになります.
+//!
+//!  RESET    : type(1) index_of_game(4)
+//!  PLAY     : type(1) turn(2) you_hands(5) op_hands(5) top_left(1) top_right(1) you_previous(1) op_previous(1)
+//!  GAMESET  : type(1) you_point(2) op_point(2) you_score(4) op_score(4)
+//!
+//! サーバーに --batch を与えると, 1組のプレイヤーで複数のゲームを同時に進めます.
+//! 手番のゲームの局面をまとめて1つの BATCHPLAY で送り, プレイヤーは行動を局面の順に count バイトで返します.
+//! ゲームは index_of_game で区別し, RESET は同時に進むゲームごとに送られます. 終わったゲームには BATCHGAMESET を送ります.
+//!
+//!  BATCHPLAY    : type(1) count(1) { index_of_game(4) turn(2) you_hands(5) op_hands(5) top_left(1) top_right(1) you_previous(1) op_previous(1) } * count
+//!  BATCHGAMESET : type(1) index_of_game(4) you_point(2) op_point(2) you_score(4) op_score(4)
+//!
+//! 手札は番号を昇順に並べ, 5枚に満たない分は 0 で埋めます. 場は一番上の札だけを送ります.
+//! プレイヤーは RESET, GAMESET と BATCHGAMESET には受け取った type を1バイトで, PLAY には行動を1バイトで返します.
+//! 行動は上位4ビットが種類 ( Slow-Plugin.h の slow_plugin_operation と同じ値 ), 下位4ビットが札の番号です.
+//!
+
+#define SLOW_PROTOCOL_BINARY "BINARY"     //!< バイナリのプロトコルを選ぶ RESET への返答
+
+typedef enum {
+    protocol_message_reset = 1,
+    protocol_message_play = 2,
+    protocol_message_gameset = 3,
+    protocol_message_batch_play = 4,
+    protocol_message_batch_gameset = 5
+} protocol_message;
+
+static const size_t k_protocol_reset_size = 5;      //!< RESET のフレームのバイト数
+static const size_t k_protocol_play_size = 17;      //!< PLAY のフレームのバイト数
+static const size_t k_protocol_gameset_size = 13;   //!< GAMESET のフレームのバイト数
+static const size_t k_protocol_max_frame = 17;      //!< 最大のフレームのバイト数. BATCHPLAY を除く.
+static const size_t k_protocol_batch_play_header_size = 2;  //!< BATCHPLAY の type と count のバイト数
+static const size_t k_protocol_batch_play_entry_size = 20;  //!< BATCHPLAY の1局面のバイト数
+static const size_t k_protocol_batch_gameset_size = 17;     //!< BATCHGAMESET のフレームのバイト数
+static const int32_t k_protocol_max_batch = 64;             //!< BATCHPLAY の1つのフレームの最大の局面の数
+
+//! PLAY のフレームの内容
+typedef struct {
+    int32_t turn;
+    int16_t you_hands[k_max_hands+1];   //!< 0 終端
+    int16_t op_hands[k_max_hands+1];    //!< 0 終端
+    int16_t top_left;
+    int16_t top_right;
+    play_action you_previous;
+    play_action op_previous;
+} protocol_play;
+
+//! GAMESET のフレームの内容
+typedef struct {
+    int32_t you_point;
+    int32_t op_point;
+    int32_t you_score;
+    int32_t op_score;
+} protocol_gameset;
+
+uint8_t protocol_encode_action( const play_action action );
+play_action protocol_decode_action( const uint8_t byte );
+
+//! @return フレームのバイト数
+size_t protocol_encode_reset( uint8_t *frame, const int32_t index_of_game );
+size_t protocol_encode_play( uint8_t *frame, const int32_t turn, const int16_t *you_hands, const int16_t *op_hands, const int16_t top_left, const int16_t top_right, const play_action you_previous, const play_action op_previous );
+size_t protocol_encode_gameset( uint8_t *frame, const int32_t you_point, const int32_t op_point, const int32_t you_score, const int32_t op_score );
+size_t protocol_encode_batch_play_header( uint8_t *frame, const int32_t count );
+size_t protocol_encode_batch_play_entry( uint8_t *entry, const int32_t index_of_game, const int32_t turn, const int16_t *you_hands, const int16_t *op_hands, const int16_t top_left, const int16_t top_right, const play_action you_previous, const play_action op_previous );
+size_t protocol_encode_batch_gameset( uint8_t *frame, const int32_t index_of_game, const int32_t you_point, const int32_t op_point, const int32_t you_score, const int32_t op_score );
+
+//! type の1バイトを除いたフレームの残りを解釈します
+int32_t protocol_decode_reset( const uint8_t *body );
+void protocol_decode_play( const uint8_t *body, protocol_play *play );
+void protocol_decode_gameset( const uint8_t *body, protocol_gameset *gameset );
+
+//! @return 局面の数
+int32_t protocol_decode_batch_play_header( const uint8_t *body );
+
+//! @return BATCHPLAY の1局面を解釈し, ゲームの番号を返します
+int32_t protocol_decode_batch_play_entry( const uint8_t *entry, protocol_play *play );
+
+//! @return type の1バイトを除いた BATCHGAMESET を解釈し, ゲームの番号を返します
+int32_t protocol_decode_batch_gameset( const uint8_t *body, protocol_gameset *gameset );
+
+//! リトルエンディアンの整数の読み書きです. フレームと, リプレイファイルなどのファイルの形式で共通に使います.
+static inline void put_uint16( uint8_t *it, const uint16_t value )
+{
+    it[0] = (uint8_t)( value );
+    it[1] = (uint8_t)( value >> 8 );
+}
+
+static inline void put_uint32( uint8_t *it, const uint32_t value )
+{
+    it[0] = (uint8_t)( value );
+    it[1] = (uint8_t)( value >> 8 );
+    it[2] = (uint8_t)( value >> 16 );
+    it[3] = (uint8_t)( value >> 24 );
+}
+
+static inline void put_uint64( uint8_t *it, const uint64_t value )
+{
+    put_uint32( it, (uint32_t)value );
+    put_uint32( it + 4, (uint32_t)( value >> 32 ) );
+}
+
+static inline uint16_t get_uint16( const uint8_t *it )
+{
+    return (uint16_t)( it[0] | ( it[1] << 8 ) );
+}
+
+static inline uint32_t get_uint32( const uint8_t *it )
+{
+    return (uint32_t)it[0] | ( (uint32_t)it[1] << 8 ) | ( (uint32_t)it[2] << 16 ) | ( (uint32_t)it[3] << 24 );
+}
+
+static inline uint64_t get_uint64( const uint8_t *it )
+{
+    return (uint64_t)get_uint32( it ) | ( (uint64_t)get_uint32( it + 4 ) << 32 );
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "Slow-Record.h"
+#include "Slow-Protocol.h"
+
+#include <string.h>
+
+size_t record_encode_header( uint8_t *it, const int32_t number_of_games, const uint64_t index_offset )
+{
+    memcpy( it, SLOW_RECORD_MAGIC, 8 );
+    put_uint32( it + 8, k_record_version );
+    put_uint32( it + 12, (uint32_t)number_of_games );
+    put_uint64( it + 16, index_offset );
+    return k_record_header_size;
+}
+
+size_t record_encode_game( uint8_t *it, const record_game *game )
+{
+    put_uint32( it, (uint32_t)game->index_of_game );
+    put_uint32( it + 4, (uint32_t)game->number_of_actions );
+    put_uint16( it + 8, (uint16_t)game->points_p1 );
+    put_uint16( it + 10, (uint16_t)game->points_p2 );
+    it[12] = (uint8_t)game->first;
+    for ( int32_t i = 0; i < k_number_of_deck; i++ ) {
+        it[13 + i] = (uint8_t)game->deck_p1[i];
+        it[13 + k_number_of_deck + i] = (uint8_t)game->deck_p2[i];
+    }
+    return k_record_game_size;
+}
+
+bool record_decode_header( const uint8_t *data, const size_t size, record_header *header )
+{
+    if ( size < k_record_header_size ) return false;
+    if ( memcmp( data, SLOW_RECORD_MAGIC, 8 ) != 0 ) return false;
+    if ( get_uint32( data + 8 ) != k_record_version ) return false;
+
+    header->number_of_games = (int32_t)get_uint32( data + 12 );
+    header->index_offset = get_uint64( data + 16 );
+    if ( header->number_of_games < 0 ) return false;
+    if ( header->index_offset > size ) return false;
+    return ( size - header->index_offset ) / 8 >= (uint64_t)header->number_of_games;
+}
+
+bool record_has_game( const uint8_t *data, const record_header *header, const int32_t n )
+{
+    if ( n < 0 || n >= header->number_of_games ) return false;
+    return get_uint64( data + header->index_offset + (uint64_t)n * 8 ) != 0;
+}
+
+bool record_decode_game( const uint8_t *data, const size_t size, const record_header *header, const int32_t n, record_game *game )
+{
+    if ( n < 0 || n >= header->number_of_games ) return false;
+    const uint64_t offset = get_uint64( data + header->index_offset + (uint64_t)n * 8 );
+    if ( offset < k_record_header_size || offset > size || size - offset < k_record_game_size ) return false;
+
+    const uint8_t *it = data + offset;
+    game->index_of_game = (int32_t)get_uint32( it );
+    game->number_of_actions = (int32_t)get_uint32( it + 4 );
+    game->points_p1 = (int16_t)get_uint16( it + 8 );
+    game->points_p2 = (int16_t)get_uint16( it + 10 );
+    game->first = it[12];
+    if ( game->first != 0 && game->first != 1 ) return false;
+    for ( int32_t i = 0; i < k_number_of_deck; i++ ) {
+        game->deck_p1[i] = it[13 + i];
+        game->deck_p2[i] = it[13 + k_number_of_deck + i];
+    }
+    if ( ! deck_is_valid( game->deck_p1 ) || ! deck_is_valid( game->deck_p2 ) ) return false;
+    game->actions = it + k_record_game_size;
+    return game->number_of_actions >= 0 && (uint64_t)game->number_of_actions <= size - offset - k_record_game_size;
+}
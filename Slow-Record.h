@@ -0,0 +1,75 @@
+#ifndef SLOW_RECORD_H
+#define SLOW_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Slow-Rule.h"
+
+//!
+//! 対戦を記録するバイナリのリプレイファイルの形式です.
+//!
+//! ファイルはメモリに写像してそのまま読めるように, すべてリトルエンディアンの固定の並びです.
+//!
+//!  ヘッダー  : magic(8) version(4) number_of_games(4) index_offset(8)
+//!  ゲーム    : index_of_game(4) number_of_actions(4) points_p1(2) points_p2(2) first(1) deck_p1(26) deck_p2(26) actions(number_of_actions)
+//!  索引      : offset(8) x number_of_games
+//!
+//! 山札は配られた順に1枚1バイト, 行動は Slow-Protocol.h の行動の1バイトです.
+//! 最後の行動が 0 ( 行動なし ) のゲームは, その手番のプレイヤーの時間切れによる負けで終わっています.
+//! 索引の n 番目はファイルの先頭から n 番目のゲームまでのバイト数で, 記録されなかったゲームは 0 です.
+//!
+
+#define SLOW_RECORD_MAGIC "SLOWRPLY"    //!< ファイルの先頭の8バイト
+
+static const uint32_t k_record_version = 1;         //!< 形式のバージョン
+static const size_t k_record_header_size = 24;      //!< ヘッダーのバイト数
+static const size_t k_record_game_size = 65;        //!< 行動を除くゲームのバイト数
+
+//! ヘッダーの内容
+typedef struct {
+    int32_t number_of_games;
+    uint64_t index_offset;
+} record_header;
+
+//! 1ゲームの記録
+typedef struct {
+    int32_t index_of_game;
+    int32_t first;                      //!< 最初のターンのプレイヤー
+    int32_t points_p1;
+    int32_t points_p2;
+    int16_t deck_p1[k_number_of_deck];
+    int16_t deck_p2[k_number_of_deck];
+    int32_t number_of_actions;
+    const uint8_t *actions;             //!< 1ターン1バイトの行動
+} record_game;
+
+//! @return バイト数
+size_t record_encode_header( uint8_t *it, const int32_t number_of_games, const uint64_t index_offset );
+
+//! 行動を除くゲームを書き込みます. 行動はこの後にそのまま続けます.
+//! @return バイト数
+size_t record_encode_game( uint8_t *it, const record_game *game );
+
+//!
+//! @brief  ファイル全体からヘッダーを読みます
+//!
+//! @return 形式が正しくなければ false
+//!
+bool record_decode_header( const uint8_t *data, const size_t size, record_header *header );
+
+//! @return n 番目のゲームが索引にあれば true. 記録が正しいかは確かめない.
+bool record_has_game( const uint8_t *data, const record_header *header, const int32_t n );
+
+//!
+//! @brief  ファイル全体から索引を使って n 番目のゲームを読みます
+//!
+//! @param  game    [out]actions は data の中を指す
+//!
+//! @return 記録されていないか範囲外であるか, first が 0 か 1 でないか,
+//!         山札が 1 から 13 を2枚ずつ並べたものでなければ false
+//!
+bool record_decode_game( const uint8_t *data, const size_t size, const record_header *header, const int32_t n, record_game *game );
+
+#endif
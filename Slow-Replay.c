@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Slow-Rule.h"
+#include "Slow-Protocol.h"
+#include "Slow-Record.h"
+
+// options
+static const char *option_replay = NULL;
+static int32_t option_game = -1;
+
+void version()
+{
+    fprintf( stdout, "Slow-Replay version 0.01\n" );
+}
+
+void usage()
+{
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "使い方\n" );
+    fprintf( stdout, "./Slow-Replay --replay FILE\n" );
+    fprintf( stdout, "\n" );
+    fprintf( stdout, "オプション\n" );
+    fprintf( stdout, " --replay Slow-Server の --replay で記録したリプレイファイル. すべてのゲームをルールで再現して検証する.\n" );
+    fprintf( stdout, " --game 指定した番号のゲームだけを1ターンずつ表示する. 番号は 1 から.\n" );
+    fprintf( stdout, " --version バージョン情報表示.\n" );
+    fprintf( stdout, "\n" );
+}
+
+void print_hands( const int16_t *hands )
+{
+    while ( *hands != 0 ) {
+        fprintf( stdout, "%d ", *(hands++) );
+    }
+}
+
+void print_action( const play_action action )
+{
+    if ( action.operation == play_operation_pass ) {
+        fprintf( stdout, "パス" );
+    } else if ( action.operation == play_operation_draw ) {
+        fprintf( stdout, "山札から１枚引く" );
+    } else if ( action.operation == play_operation_put_left ) {
+        fprintf( stdout, "左に %d を置く", action.card );
+    } else if ( action.operation == play_operation_put_right ) {
+        fprintf( stdout, "右に %d を置く", action.card );
+    } else {
+        fprintf( stdout, "未定義の行動 %d", action.card );
+    }
+}
+
+// result of re-simulating a recorded game.
+typedef enum {
+    replay_result_ok = 0,
+    replay_result_illegal,      // an action the rules do not allow.
+    replay_result_unfinished,   // the actions ran out before the end.
+    replay_result_overrun,      // actions are left after the end.
+    replay_result_points,       // the recorded points differ.
+    replay_result_corrupt       // the decks or the first player are not valid.
+} replay_result;
+
+static const char *k_replay_result_names[] = { "OK", "ILLEGAL", "UNFINISHED", "OVERRUN", "POINTS", "CORRUPT" };
+
+replay_result replay_game( const record_game *game, const bool print )
+{
+    game_state state;
+    game_init( &state, game->deck_p1, game->deck_p2, game->first );
+
+    int16_t hands[k_max_hands+1];
+    int32_t forfeit = -1;
+    for ( int32_t i = 0; i < game->number_of_actions; i++ ) {
+        if ( game_is_end( &state ) ) return replay_result_overrun;
+
+        // a null action as the last one is the forfeit of the player to move.
+        if ( protocol_decode_action( game->actions[i] ).operation == play_operation_null ) {
+            if ( i != game->number_of_actions - 1 ) return replay_result_illegal;
+            forfeit = game_turn_player( &state );
+            if ( print ) fprintf( stdout, forfeit == 0 ? "P1は時間切れで負けました.\n" : "P2は時間切れで負けました.\n" );
+            break;
+        }
+
+        if ( print ) {
+            fprintf( stdout, "ターン数: %d\n", state.index_of_turn+1 );
+            fprintf( stdout, "場: 左%d 右%d\n", place_top( &state.left ), place_top( &state.right ) );
+            fprintf( stdout, "P1の手札: " );
+            hands_sequence( &state.players[0], hands );
+            print_hands( hands );
+            fprintf( stdout, "\nP2の手札: " );
+            hands_sequence( &state.players[1], hands );
+            print_hands( hands );
+            fprintf( stdout, "\n" );
+        }
+
+        const int32_t index_of_player = game_turn_player( &state );
+        const play_action action = protocol_decode_action( game->actions[i] );
+        const play_action played = game_apply( &state, action );
+        if ( ! is_equals_play_action( played, action ) ) return replay_result_illegal;
+
+        if ( print ) {
+            fprintf( stdout, index_of_player == 0 ? "P1の行動: " : "P2の行動: " );
+            print_action( played );
+            fprintf( stdout, "\n\n" );
+        }
+    }
+    if ( forfeit < 0 && ! game_is_end( &state ) ) return replay_result_unfinished;
+
+    int32_t points_p1;
+    int32_t points_p2;
+    if ( forfeit >= 0 ) {
+        game_forfeit_points( &state, forfeit, &points_p1, &points_p2 );
+    } else {
+        game_points( &state, &points_p1, &points_p2 );
+    }
+    if ( print ) {
+        fprintf( stdout, "P1 POINTS: %d\n", points_p1 );
+        fprintf( stdout, "P2 POINTS: %d\n", points_p2 );
+    }
+    return points_p1 == game->points_p1 && points_p2 == game->points_p2 ? replay_result_ok : replay_result_points;
+}
+
+int main( const int argc, const char *argv[] )
+{
+    // get options.
+    for ( int i = 1; i < argc; i++ ) {
+        if ( i+1 < argc && strcmp( argv[i], "--replay" ) == 0 ) {
+            option_replay = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--game" ) == 0 ) {
+            option_game = atoi( argv[++i] ) - 1;
+        } else if ( strcmp( argv[i], "--version" ) == 0 ) {
+            version();
+            return EXIT_SUCCESS;
+        } else {
+            fprintf( stdout, "error: 不明な引数 %s が与えられました.\n", argv[i] );
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ( ! option_replay ) {
+        fprintf( stdout, "error: 引数 --replay を与えてください.\n" );
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // map the whole file. games are read in place.
+    const int fd = open( option_replay, O_RDONLY );
+    if ( fd == -1 ) {
+        fprintf( stderr, "error: %s を開けませんでした(%d).\n", option_replay, __LINE__ );
+        return EXIT_FAILURE;
+    }
+    struct stat status;
+    if ( fstat( fd, &status ) == -1 || status.st_size == 0 ) {
+        fprintf( stderr, "error: %s の大きさを取得できませんでした(%d).\n", option_replay, __LINE__ );
+        close( fd );
+        return EXIT_FAILURE;
+    }
+    const size_t size = (size_t)status.st_size;
+    const uint8_t *data = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( data == MAP_FAILED ) {
+        fprintf( stderr, "error: mmap に失敗しました(%d).\n", __LINE__ );
+        return EXIT_FAILURE;
+    }
+
+    int exit_code = EXIT_SUCCESS;
+    record_header header;
+    record_game game;
+    if ( ! record_decode_header( data, size, &header ) ) {
+        fprintf( stderr, "error: %s はリプレイファイルではありません(%d).\n", option_replay, __LINE__ );
+        exit_code = EXIT_FAILURE;
+    } else if ( option_game >= 0 ) {
+        // print one game.
+        if ( record_decode_game( data, size, &header, option_game, &game ) ) {
+            fprintf( stdout, "第 %d ゲーム\n", game.index_of_game+1 );
+            const replay_result result = replay_game( &game, true );
+            fprintf( stdout, "RESULT: %s\n", k_replay_result_names[result] );
+            if ( result != replay_result_ok ) exit_code = EXIT_FAILURE;
+        } else if ( record_has_game( data, &header, option_game ) ) {
+            fprintf( stdout, "RESULT: %s\n", k_replay_result_names[replay_result_corrupt] );
+            exit_code = EXIT_FAILURE;
+        } else {
+            fprintf( stderr, "error: 第 %d ゲームは記録されていません(%d).\n", option_game+1, __LINE__ );
+            exit_code = EXIT_FAILURE;
+        }
+    } else {
+        // verify all games.
+        madvise( (void *)data, size, MADV_SEQUENTIAL );
+        const clock_t begin = clock();
+        int64_t number_of_moves = 0;
+        int64_t score_p1 = 0;
+        int64_t score_p2 = 0;
+        int32_t number_of_games = 0;
+        int32_t number_of_missing = 0;
+        int32_t number_of_errors = 0;
+        for ( int32_t i = 0; i < header.number_of_games; i++ ) {
+            if ( ! record_decode_game( data, size, &header, i, &game ) ) {
+                // a game in the index that does not decode is broken, not missing.
+                if ( record_has_game( data, &header, i ) ) {
+                    fprintf( stdout, "%d: %s\n", i+1, k_replay_result_names[replay_result_corrupt] );
+                    number_of_errors++;
+                } else {
+                    number_of_missing++;
+                }
+                continue;
+            }
+            const replay_result result = replay_game( &game, false );
+            if ( result != replay_result_ok ) {
+                fprintf( stdout, "%d: %s\n", i+1, k_replay_result_names[result] );
+                number_of_errors++;
+            }
+            number_of_games++;
+            number_of_moves += game.number_of_actions;
+            score_p1 += game.points_p1;
+            score_p2 += game.points_p2;
+        }
+        const double seconds = (double)( clock() - begin ) / CLOCKS_PER_SEC;
+
+        fprintf( stdout, "GAMES: %d\n", number_of_games );
+        fprintf( stdout, "MISSING: %d\n", number_of_missing );
+        fprintf( stdout, "ERRORS: %d\n", number_of_errors );
+        fprintf( stdout, "MOVES: %lld\n", (long long)number_of_moves );
+        fprintf( stdout, "P1 SCORE: %lld\n", (long long)score_p1 );
+        fprintf( stdout, "P2 SCORE: %lld\n", (long long)score_p2 );
+        fprintf( stdout, "GAMES/SEC: %.0f\n", seconds > 0 ? number_of_games / seconds : 0.0 );
+        if ( number_of_missing > 0 || number_of_errors > 0 ) exit_code = EXIT_FAILURE;
+    }
+
+    munmap( (void *)data, size );
+    return exit_code;
+}
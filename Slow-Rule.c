@@ -0,0 +1,335 @@
+#include "Slow-Rule.h"
+
+#include <string.h>
+#include <assert.h>
+
+static const int16_t k_initial_deck[k_number_of_deck] = {1,2,3,4,5,6,7,8,9,10,11,12,13,1,2,3,4,5,6,7,8,9,10,11,12,13};
+
+play_action play_action_make( const play_operation operation, const int16_t card )
+{
+    play_action action = { operation, card };
+    return action;
+}
+
+bool is_equals_play_action( const play_action a1, const play_action a2 )
+{
+    return a1.operation == a2.operation && a1.card == a2.card;
+}
+
+static uint64_t random_mix( uint64_t z )
+{
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+void game_random_seed( game_random *random, const uint64_t seed )
+{
+    random->state = seed;
+}
+
+void game_random_seed_stream( game_random *random, const uint64_t seed, const uint64_t index )
+{
+    // mix twice so that neighbouring seeds and indices start far apart.
+    random->state = random_mix( seed ^ random_mix( index + 0x9e3779b97f4a7c15ULL ) );
+}
+
+uint32_t game_random_next( game_random *random )
+{
+    // splitmix64.
+    return (uint32_t)( random_mix( random->state += 0x9e3779b97f4a7c15ULL ) >> 32 );
+}
+
+uint32_t game_random_bounded( game_random *random, const uint32_t bound )
+{
+    // multiply and reject the biased low part.
+    uint64_t m = (uint64_t)game_random_next( random ) * bound;
+    if ( (uint32_t)m < bound ) {
+        const uint32_t threshold = -bound % bound;
+        while ( (uint32_t)m < threshold ) {
+            m = (uint64_t)game_random_next( random ) * bound;
+        }
+    }
+    return (uint32_t)( m >> 32 );
+}
+
+void deck_init( int16_t *deck )
+{
+    memcpy( deck, k_initial_deck, sizeof( k_initial_deck ) );
+}
+
+bool deck_is_valid( const int16_t *deck )
+{
+    int32_t counts[k_number_of_ranks+1] = {};
+    for ( int32_t i = 0; i < k_number_of_deck; i++ ) {
+        if ( deck[i] < 1 || deck[i] > k_number_of_ranks || ++counts[deck[i]] > 2 ) return false;
+    }
+    return true;
+}
+
+static void deck_swap( int16_t *v1, int16_t *v2 )
+{
+    int16_t t = *v1;
+    *v1 = *v2;
+    *v2 = t;
+}
+
+void deck_shuffle( int16_t *deck, const size_t size, game_random *random )
+{
+    for ( size_t i = 0; i < size; i++ ) {
+        deck_swap( deck+i, deck + i + game_random_bounded( random, (uint32_t)( size-i ) ) );
+    }
+}
+
+void deck_deal( int16_t *deck_p1, int16_t *deck_p2, const uint64_t seed, const int32_t index_of_game )
+{
+    game_random random;
+    game_random_seed_stream( &random, seed, (uint64_t)index_of_game );
+    deck_init( deck_p1 );
+    deck_init( deck_p2 );
+    deck_shuffle( deck_p1, k_number_of_deck, &random );
+    deck_shuffle( deck_p2, k_number_of_deck, &random );
+}
+
+void game_init( game_state *state, const int16_t *deck_p1, const int16_t *deck_p2, const int32_t first )
+{
+    memset( state, 0, sizeof( *state ) );
+    state->first = first;
+    const int16_t *decks[2] = { deck_p1, deck_p2 };
+    for ( int32_t i = 0; i < 2; i++ ) {
+        player_cards *cards = &state->players[i];
+        memcpy( cards->deck, decks[i], sizeof( cards->deck ) );
+        for ( int32_t j = 0; j < k_number_of_deck; j++ ) {
+            cards->sum += cards->deck[j];
+        }
+    }
+}
+
+void game_init_seed( game_state *state, const uint64_t seed, const int32_t first )
+{
+    game_random random;
+    game_random_seed( &random, seed );
+
+    int16_t deck_p1[k_number_of_deck];
+    int16_t deck_p2[k_number_of_deck];
+    deck_init( deck_p1 );
+    deck_init( deck_p2 );
+    deck_shuffle( deck_p1, k_number_of_deck, &random );
+    deck_shuffle( deck_p2, k_number_of_deck, &random );
+    game_init( state, deck_p1, deck_p2, first );
+}
+
+int16_t place_top( const place_pile *place )
+{
+    return place->cards[k_max_place - place->length];
+}
+
+const int16_t *place_sequence( const place_pile *place )
+{
+    return place->cards + k_max_place - place->length;
+}
+
+static void place_push( place_pile *place, const int16_t card )
+{
+    assert( place->length < k_max_place );
+    place->length++;
+    place->cards[k_max_place - place->length] = card;
+}
+
+int32_t number_of_deck( const player_cards *cards )
+{
+    return k_number_of_deck - cards->deck_top;
+}
+
+void hands_sequence( const player_cards *cards, int16_t *sequence )
+{
+    for ( int16_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+        for ( int32_t i = 0; i < cards->hands[rank]; i++ ) {
+            *(sequence++) = rank;
+        }
+    }
+    *sequence = 0;
+}
+
+// ranks that can be put on each top, upper first. top 0 is an empty pile.
+static const int16_t k_neighbor_ranks[k_number_of_ranks+1][2] = {
+    {0,0}, {2,13}, {3,1}, {4,2}, {5,3}, {6,4}, {7,5}, {8,6}, {9,7}, {10,8}, {11,9}, {12,10}, {13,11}, {1,12}
+};
+
+static int16_t lowest_rank( const uint16_t mask )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return (int16_t)__builtin_ctz( mask );
+#else
+    int16_t rank = 0;
+    while ( ( mask & ( 1u << rank ) ) == 0 ) rank++;
+    return rank;
+#endif
+}
+
+uint16_t hands_mask( const int8_t *hands )
+{
+    uint16_t mask = 0;
+    for ( int16_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+        if ( hands[rank] > 0 ) mask |= (uint16_t)( 1u << rank );
+    }
+    return mask;
+}
+
+static int32_t play_action_put_candidate( play_action *candidates, const uint16_t mask, const int8_t *hands, const int16_t top, const play_operation operation )
+{
+    const play_action * const candidate_begin  = candidates;
+    if ( top == 0 ) {
+        for ( uint16_t rest = mask; rest != 0; rest &= rest - 1 ) {
+            const int16_t rank = lowest_rank( rest );
+            for ( int32_t i = 0; i < hands[rank]; i++ ) {
+                *(candidates++) = play_action_make( operation, rank );
+            }
+        }
+    } else {
+        const int16_t upper = k_neighbor_ranks[top][0];
+        const int16_t lower = k_neighbor_ranks[top][1];
+        if ( mask & ( 1u << upper ) ) {
+            *(candidates++) = play_action_make( operation, upper );
+        }
+        if ( mask & ( 1u << lower ) ) {
+            *(candidates++) = play_action_make( operation, lower );
+        }
+    }
+
+    return (int32_t)( candidates - candidate_begin );
+}
+
+int32_t play_action_candidates_mask( play_action *candidates, const play_action previous, const uint16_t mask, const int8_t *hands, const bool can_draw, const int16_t top_left, const int16_t top_right )
+{
+    const play_action * const candidate_begin  = candidates;
+
+    if ( previous.operation == play_operation_pass ) {
+        for ( uint16_t rest = mask; rest != 0; rest &= rest - 1 ) {
+            const int16_t rank = lowest_rank( rest );
+            for ( int32_t i = 0; i < hands[rank]; i++ ) {
+                *(candidates++) = play_action_make( play_operation_put_left, rank );
+                *(candidates++) = play_action_make( play_operation_put_right, rank );
+            }
+        }
+    } else {
+        candidates += play_action_put_candidate( candidates, mask, hands, top_left, play_operation_put_left );
+        candidates += play_action_put_candidate( candidates, mask, hands, top_right, play_operation_put_right );
+    }
+
+    if ( can_draw ) {
+        *(candidates++) = play_action_make( play_operation_draw, 0 );
+    }
+
+    if ( previous.operation != play_operation_pass || (candidates - candidate_begin) == 0 ) {
+        *(candidates++) = play_action_make( play_operation_pass, 0 );
+    }
+
+    return (int32_t)(candidates - candidate_begin);
+}
+
+int32_t play_action_candidates( play_action *candidates, const play_action previous, const int8_t *hands, const int32_t number_of_hands, const int32_t number_of_deck, const int16_t top_left, const int16_t top_right )
+{
+    return play_action_candidates_mask( candidates, previous, hands_mask( hands ), hands, number_of_hands < k_max_hands && number_of_deck > 0, top_left, top_right );
+}
+
+int32_t game_turn_player( const game_state *state )
+{
+    return ( state->index_of_turn + state->first ) % 2;
+}
+
+int32_t game_legal_moves( const game_state *state, play_action *candidates )
+{
+    const int32_t index_of_player = game_turn_player( state );
+    const player_cards *cards = &state->players[index_of_player];
+    const bool can_draw = cards->number_of_hands < k_max_hands && cards->deck_top < k_number_of_deck;
+    return play_action_candidates_mask( candidates, state->previous[index_of_player], cards->hands_mask, cards->hands, can_draw, place_top( &state->left ), place_top( &state->right ) );
+}
+
+static bool is_member_play_actions( const play_action *actions, const play_action member, const size_t size )
+{
+    for ( size_t i = 0; i < size; i++ ) {
+        if ( is_equals_play_action( actions[i], member ) ) return true;
+    }
+    return false;
+}
+
+static void play_draw( player_cards *cards )
+{
+    assert( number_of_deck( cards ) > 0 );
+    const int16_t card = cards->deck[cards->deck_top++];
+    cards->hands[card]++;
+    cards->hands_mask |= (uint16_t)( 1u << card );
+    cards->number_of_hands++;
+}
+
+static void play_put( player_cards *cards, place_pile *place, const int16_t card )
+{
+    assert( cards->hands[card] > 0 );
+    if ( --cards->hands[card] == 0 ) cards->hands_mask &= (uint16_t)~( 1u << card );
+    cards->number_of_hands--;
+    cards->sum -= card;
+    place_push( place, card );
+}
+
+play_action game_apply( game_state *state, play_action action )
+{
+    play_action candidates[play_action_candidate_max];
+    const int32_t number_of_candidates = game_legal_moves( state, candidates );
+    assert( number_of_candidates > 0 );
+
+    if ( ! is_member_play_actions( candidates, action, number_of_candidates ) ) {
+        // select force an action in candidtes.
+        action = candidates[0];
+    }
+
+    game_play( state, action );
+    return action;
+}
+
+void game_play( game_state *state, const play_action action )
+{
+    const int32_t index_of_player = game_turn_player( state );
+    player_cards *cards = &state->players[index_of_player];
+
+    if ( action.operation == play_operation_draw ) {
+        play_draw( cards );
+    } else if ( action.operation == play_operation_put_left ) {
+        play_put( cards, &state->left, action.card );
+    } else if ( action.operation == play_operation_put_right ) {
+        play_put( cards, &state->right, action.card );
+    } else {
+        assert( action.operation == play_operation_pass );
+    }
+
+    state->previous[index_of_player] = action;
+    state->index_of_turn++;
+}
+
+bool game_is_end( const game_state *state )
+{
+    return state->players[0].sum == 0 || state->players[1].sum == 0;
+}
+
+void game_points( const game_state *state, int32_t *points_p1, int32_t *points_p2 )
+{
+    const int32_t sum_p1 = state->players[0].sum;
+    const int32_t sum_p2 = state->players[1].sum;
+    *points_p1 = 0;
+    *points_p2 = 0;
+    if ( sum_p1 == 0 ) {
+        *points_p1 += sum_p2;
+        *points_p2 -= sum_p2;
+    }
+    if ( sum_p2 == 0 ) {
+        *points_p1 -= sum_p1;
+        *points_p2 += sum_p1;
+    }
+}
+
+void game_forfeit_points( const game_state *state, const int32_t index_of_player, int32_t *points_p1, int32_t *points_p2 )
+{
+    const int32_t sum = state->players[index_of_player].sum;
+    *points_p1 = index_of_player == 0 ? -sum : sum;
+    *points_p2 = -*points_p1;
+}
@@ -0,0 +1,171 @@
+#ifndef SLOW_RULE_H
+#define SLOW_RULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//!
+//! Slow のルールを入出力なしで実行するためのライブラリです.
+//! サーバーとサンプルプレイヤーはどちらもこのルールの上に作られています.
+//!
+
+static const int32_t k_number_of_ranks = 13;    //!< 札の番号の数 ( 1 から 13 )
+static const int32_t k_number_of_deck = 26;     //!< 1人の山札の枚数
+static const int32_t k_max_hands = 5;           //!< 手札の最大の枚数
+static const int32_t k_max_place = 52;          //!< 場の1つの山に積まれうる最大の枚数
+
+typedef enum {
+    play_operation_null = 0,    //!< 行動なし
+    play_operation_error,       //!< 行動を受け取れなかった
+    play_operation_invalid,     //!< 解釈できない行動
+    play_operation_pass,        //!< パス
+    play_operation_draw,        //!< 山札から1枚引く
+    play_operation_put_left,    //!< 場の左に札を1枚出す
+    play_operation_put_right,   //!< 場の右に札を1枚出す
+    play_operation_timeout      //!< 制限時間内に行動を受け取れなかった
+} play_operation;
+
+typedef struct {
+    play_operation operation;
+    int16_t card;
+} play_action;
+
+//! 1人のプレイヤーの札. 山札は deck[deck_top] から引かれ, 手札は番号ごとの枚数で持つ.
+typedef struct {
+    int16_t deck[k_number_of_deck];
+    int32_t deck_top;
+    int8_t hands[k_number_of_ranks+1];  //!< 番号ごとの枚数. 添字 0 は使わない.
+    uint16_t hands_mask;                //!< 手札にある番号のビット ( 1 << 番号 ). hands と一緒に更新する.
+    int32_t number_of_hands;
+    int32_t sum;                        //!< 山札と手札の番号の合計
+} player_cards;
+
+//! 場の1つの山. 札は配列の末尾から先頭に向かって積まれるので,
+//! cards + k_max_place - length は常に上から順の 0 終端の配列になる.
+typedef struct {
+    int16_t cards[k_max_place+1];
+    int32_t length;
+} place_pile;
+
+//! 1ゲームの状態
+typedef struct {
+    player_cards players[2];
+    place_pile left;
+    place_pile right;
+    play_action previous[2];    //!< 各プレイヤーの前回の行動
+    int32_t index_of_turn;
+    int32_t first;              //!< 最初のターンのプレイヤー ( 0 か 1 )
+} game_state;
+
+//! game_legal_moves が返しうる最大の数
+static const size_t play_action_candidate_max = 12;
+
+//! 乱数の状態. splitmix64 なので状態は seed に定数を足していくカウンタで, 出力はその混合です.
+typedef struct {
+    uint64_t state;
+} game_random;
+
+play_action play_action_make( const play_operation operation, const int16_t card );
+bool is_equals_play_action( const play_action a1, const play_action a2 );
+
+void game_random_seed( game_random *random, const uint64_t seed );
+
+//!
+//! @brief  seed と index から独立した乱数列を作ります
+//!
+//! 他の乱数列の状態を共有せずに, 何番目の乱数列でも直接作ることができます.
+//!
+void game_random_seed_stream( game_random *random, const uint64_t seed, const uint64_t index );
+uint32_t game_random_next( game_random *random );
+uint32_t game_random_bounded( game_random *random, const uint32_t bound );
+
+//! 1 から 13 を2枚ずつ並べた混ぜる前の山札を作ります
+void deck_init( int16_t *deck );
+
+//! @return deck が 1 から 13 を2枚ずつ並べたものであれば true
+bool deck_is_valid( const int16_t *deck );
+
+//!
+//! @brief  山札を混ぜます
+//!
+void deck_shuffle( int16_t *deck, const size_t size, game_random *random );
+
+//!
+//! @brief  seed の index_of_game 番目のゲームの山札を配ります
+//!
+//! 同じ seed と index_of_game からは, 他のゲームを配ったかどうかによらず常に同じ山札が作られます.
+//!
+void deck_deal( int16_t *deck_p1, int16_t *deck_p2, const uint64_t seed, const int32_t index_of_game );
+
+//!
+//! @brief  与えられた山札でゲームを初期化します
+//!
+//! @param  first   [in]最初のターンのプレイヤー. サーバーでは index_of_game % 2
+//!
+void game_init( game_state *state, const int16_t *deck_p1, const int16_t *deck_p2, const int32_t first );
+
+//!
+//! @brief  seed から山札を作りゲームを初期化します
+//!
+void game_init_seed( game_state *state, const uint64_t seed, const int32_t first );
+
+int16_t place_top( const place_pile *place );
+const int16_t *place_sequence( const place_pile *place );
+int32_t number_of_deck( const player_cards *cards );
+void hands_sequence( const player_cards *cards, int16_t *sequence );
+
+//!
+//! @brief  手札と場から行動の候補をすべて取得します
+//!
+//! @param  candidates      [out]候補. play_action_candidate_max 以上の配列.
+//! @param  hands           [in]番号ごとの手札の枚数 ( 添字 1 から 13 )
+//! @param  number_of_deck  [in]山札の残りの枚数
+//!
+//! @return 候補の数
+//!
+int32_t play_action_candidates( play_action *candidates, const play_action previous, const int8_t *hands, const int32_t number_of_hands, const int32_t number_of_deck, const int16_t top_left, const int16_t top_right );
+
+//! 番号ごとの枚数から手札にある番号のビットを作ります
+uint16_t hands_mask( const int8_t *hands );
+
+//!
+//! @brief  手札のビットから行動の候補をすべて取得します
+//!
+//! 場の一番上の札に置ける番号は表で引き, 手札はビットの立っている番号だけを見ます. 候補の順番は play_action_candidates と同じです.
+//!
+//! @param  mask        [in]手札にある番号のビット. hands_mask( hands ) と一致すること.
+//! @param  hands       [in]番号ごとの手札の枚数. 同じ番号が2枚ある場合の候補に使う.
+//! @param  can_draw    [in]山札から引けるか
+//!
+int32_t play_action_candidates_mask( play_action *candidates, const play_action previous, const uint16_t mask, const int8_t *hands, const bool can_draw, const int16_t top_left, const int16_t top_right );
+
+//! このターンに行動するプレイヤー
+int32_t game_turn_player( const game_state *state );
+
+//! このターンに行動するプレイヤーの行動の候補
+int32_t game_legal_moves( const game_state *state, play_action *candidates );
+
+//!
+//! @brief  このターンのプレイヤーの行動を実行し, 次のターンに進めます
+//!
+//! @return 実行した行動. 候補にない行動は候補の先頭の行動に置き換えられる.
+//!
+play_action game_apply( game_state *state, const play_action action );
+
+//!
+//! @brief  候補にあると分かっている行動を確かめずに実行し, 次のターンに進めます
+//!
+//! 探索のように game_legal_moves の候補から選んだ行動を速く進めるためのもので, 候補にない行動を与えてはいけません.
+//!
+void game_play( game_state *state, const play_action action );
+
+bool game_is_end( const game_state *state );
+
+//! ゲーム終了時の各プレイヤーのポイント
+void game_points( const game_state *state, int32_t *points_p1, int32_t *points_p2 );
+
+//! index_of_player のプレイヤーが負けを認めた時のポイント. 相手が札を出し切ったものとして数える.
+void game_forfeit_points( const game_state *state, const int32_t index_of_player, int32_t *points_p1, int32_t *points_p2 );
+
+#endif
@@ -1,26 +1,103 @@
+#define _GNU_SOURCE // dlmopen
+
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <assert.h>
+#include <math.h>
 
 #include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <dlfcn.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "Slow-Plugin.h"
+#include "Slow-Rule.h"
+#include "Slow-Protocol.h"
+#include "Slow-Record.h"
+#include "Slow-Shm.h"
+#include "Slow-Deal.h"
 
 // constants.
 static const int32_t k_max_line = 256;
 static const int32_t k_max_arg = 9;
+static const int32_t k_max_league = 64;
+static const int32_t k_max_read_buffer = 4096;
+static const int32_t k_max_write_buffer = 4096;
+static const int32_t k_max_log_buffer = 65536;
+static const int32_t k_max_log_writer_buffer = 1 << 20;
+static const int32_t k_latency_buckets = 496;
+static const int32_t k_max_events = 256;
+static const int32_t k_deal_block_games = 256;   // games a dispatcher deals at once.
+
+// output levels.
+typedef enum {
+    output_silent = 0,  // only total scores.
+    output_game,        // points of every game.
+    output_turn         // every turn.
+} output_level;
+
+// latency reports.
+typedef enum {
+    latency_none = 0,   // not measured.
+    latency_run,        // at the end of the run.
+    latency_game        // also after each game.
+} latency_level;
+
+// what happens when a player runs out of time.
+typedef enum {
+    timeout_auto = 0,   // the first candidate is played for the player.
+    timeout_forfeit     // the player loses the game.
+} timeout_outcome;
+
+// how requests and replies go to a player process.
+typedef enum {
+    transport_pipe = 0,
+    transport_shm       // shared memory rings when the player accepts, pipes otherwise.
+} transport_kind;
 
 // options
 static bool option_verbose = false;
+static output_level option_output = output_turn;
+#ifndef SLOW_SERVER_NO_MAIN
+// read by main() only. Slow-Bench includes this file without it.
 static const char *option_player1 = NULL;
 static const char *option_player2 = NULL;
+static const char *option_player1_so = NULL;
+static const char *option_player2_so = NULL;
 static const char *option_arguments1[k_max_arg+1] = {};
 static int32_t option_number_of_arguments1 = 0;
 static const char *option_arguments2[k_max_arg+1] = {};
 static int32_t option_number_of_arguments2 = 0;
+static int32_t option_number_of_sessions = 0;   // 0 runs jobs on threads.
+#endif
 static int32_t option_number_of_games = 1;
+static int32_t option_number_of_jobs = 1;
+static int32_t option_batch = 0;        // games a job plays at once with BATCHPLAY. 0 plays one game at a time.
+static uint64_t option_seed = 0;
+static latency_level option_latency = latency_none;
+static int32_t option_move_time = 0;    // milliseconds. 0 is no limit.
+static int32_t option_clock = 0;        // milliseconds of a game. 0 is no limit.
+static timeout_outcome option_timeout = timeout_auto;
+static transport_kind option_transport = transport_pipe;
+static double option_sprt = 0;          // points per game of P1 for H1. 0 plays all games.
+static double option_sprt_alpha = 0.05;
+static double option_sprt_beta = 0.05;
+static const char *option_replay = NULL;
+static const char *option_deals = NULL;
+static const char *option_league[k_max_league] = {};
+static int32_t option_number_of_league = 0;
 
 void version()
 {
@@ -36,18 +113,45 @@ void usage()
     fprintf( stdout, "オプション\n" );
     fprintf( stdout, " --player1 プレイヤー1の実行ファイルを指定.\n" );
     fprintf( stdout, " --player2 プレイヤー2の実行ファイルを指定.\n" );
+    fprintf( stdout, " --player1-so --player1 の代わりにプレイヤー1の共有ライブラリを指定. サーバーのプロセス内で呼び出す.\n" );
+    fprintf( stdout, " --player2-so --player2 の代わりにプレイヤー2の共有ライブラリを指定. サーバーのプロセス内で呼び出す.\n" );
     fprintf( stdout, " --arg1 プレイヤー1の実行ファイルに与える引数. 複数の引数を与える場合は繰り返し--arg1を与える.\n" );
     fprintf( stdout, " --arg2 プレイヤー2の実行ファイルに与える第N引数. 複数の引数を与える場合は繰り返し--arg2を与える.\n" );
     fprintf( stdout, " --number 対戦数.\n" );
+    fprintf( stdout, " --jobs 並列に対戦するプレイヤーの組の数. 組ごとにプレイヤーを起動し, 対戦を分担する.\n" );
+    fprintf( stdout, " --sessions 1つのスレッドで同時に対戦するプレイヤーの組の数. 組ごとにプレイヤーを起動し, 応答の来た対戦から進める. --jobs の代わりに使う.\n" );
+    fprintf( stdout, " --batch 1組のプレイヤーで同時に進めるゲームの数. 手番の局面をまとめて1つの BATCHPLAY で送る. プレイヤーはバイナリのプロトコルを選ぶ必要がある.\n" );
+    fprintf( stdout, " --seed 山札を配る乱数の種. 同じ種からは同じ順番の対戦に常に同じ山札が配られる. 省略すると現在時刻.\n" );
+    fprintf( stdout, " --latency プレイヤーの応答時間を計る. run は最後に, game はゲームごとにも表示する.\n" );
+    fprintf( stdout, " --move-time 1手の制限時間 (ミリ秒). RESET と GAMESET の応答にも使う.\n" );
+    fprintf( stdout, " --clock 1ゲームでプレイヤーが使える持ち時間の合計 (ミリ秒).\n" );
+    fprintf( stdout, " --timeout 時間切れの扱い. auto は候補の先頭の行動を選ぶ (既定), forfeit はそのゲームを負けとする.\n" );
+    fprintf( stdout, " --transport プレイヤーとの通信. pipe はパイプ (既定), shm は共有メモリ. 共有メモリに対応しないプレイヤーとはパイプで通信する.\n" );
+    fprintf( stdout, " --replay 対戦を記録するバイナリのリプレイファイル. Slow-Replay で再現できる.\n" );
+    fprintf( stdout, " --deals 山札を --seed の代わりにこの山札のファイルから配る. Slow-Generate --write-deals で作れる.\n" );
+    fprintf( stdout, " --sprt 逐次確率比検定で結果が出たら対戦を打ち切る. P1 が1ゲームあたり与えたポイント以上強い (H1) か, 強くない (H0) かを検定する.\n" );
+    fprintf( stdout, " --sprt-alpha --sprt で H0 が正しいのに H1 とする誤りの確率. 既定は 0.05.\n" );
+    fprintf( stdout, " --sprt-beta --sprt で H1 が正しいのに H0 とする誤りの確率. 既定は 0.05.\n" );
+    fprintf( stdout, " --league リーグ戦に参加するプレイヤーの実行ファイル. 繰り返し与えると総当たりで各組 --number 回対戦し, 対戦表を表示する.\n" );
     fprintf( stdout, " --version バージョン情報表示.\n" );
     fprintf( stdout, " --verbose 動作を出力.\n" );
+    fprintf( stdout, " --output 対戦の出力. silent は合計の得点のみ, game はゲームごとの得点, turn はターンごとの状態 (既定).\n" );
     fprintf( stdout, "\n" );
 }
 
-int run_player( const char *filename, const char *args[], const int pipe_in, const int pipe_out )
+int run_player( const char *filename, const char *args[], const int pipe_in, const int pipe_out, const int shm_fd )
 {
     int exit_code = EXIT_FAILURE;
     
+    // pass the shared memory to the player. it chooses whether to use it at the first RESET.
+    if ( shm_fd != -1 ) {
+        char number[12];
+        snprintf( number, sizeof( number ), "%d", shm_fd );
+        if ( fcntl( shm_fd, F_SETFD, 0 ) == -1 || setenv( SLOW_SHM_FD, number, 1 ) == -1 ) {
+            fprintf( stderr, "warn[%s]: 共有メモリを渡せませんでした(%d).\n", filename, __LINE__ );
+        }
+    }
+    
     // replace stdin, stdout to pipes.
     if ( dup2( pipe_in, STDIN_FILENO ) == -1 ) {
         fprintf( stderr, "error[%s]: dup2 に失敗しました(%d).\n", filename, __LINE__ );
@@ -81,511 +185,2177 @@ CLEAN:
     return exit_code;
 }
 
-bool write_line( const int fd, const char *line )
+// message to a player. a whole message is built here and written at once.
+typedef struct {
+    shm_ring *ring;     // written to shared memory instead of the fd when set.
+    size_t length;
+    char buffer[k_max_write_buffer];
+} message_buffer;
+
+void message_clear( message_buffer *message )
 {
-    const size_t length = strlen( line );
-    return write( fd, line, length ) == length && write( fd, "\n", 1 ) == 1;
+    message->length = 0;
 }
 
-bool read_line( const int fd, char *line, const size_t max_of_line )
+void message_append( message_buffer *message, const char *bytes, const size_t length )
 {
-    size_t bytes = 0;
-    for ( ; bytes < max_of_line; ++line, ++bytes ) {
-        if ( read( fd, line, 1 ) != 1 ) return false;
-        if ( *line == '\n' ) break;
-    }
-    *line = '\0';
-    return true;
+    assert( message->length + length <= sizeof( message->buffer ) );
+    memcpy( message->buffer + message->length, bytes, length );
+    message->length += length;
+}
+
+void message_append_int( message_buffer *message, const int32_t value )
+{
+    char digits[12];
+    char *it = digits + sizeof( digits );
+    uint32_t n = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    do {
+        *(--it) = '0' + n % 10;
+        n /= 10;
+    } while ( n != 0 );
+    if ( value < 0 ) *(--it) = '-';
+    message_append( message, it, digits + sizeof( digits ) - it );
+}
+
+void write_line( message_buffer *message, const char *line )
+{
+    message_append( message, line, strlen( line ) );
+    message_append( message, "\n", 1 );
 }
 
-bool read_to_lineend( const int fd )
+bool message_flush( message_buffer *message, const int fd )
 {
-    char c = 0;
-    while ( c != '\n' ) {
-        if ( read( fd, &c, 1 ) != 1 ) false;
+    if ( message->ring ) {
+        const bool written = shm_ring_write( message->ring, message->buffer, message->length, fd );
+        message_clear( message );
+        return written;
     }
+    
+    // write until all bytes are written, short writes are continued.
+    const char *it = message->buffer;
+    size_t rest = message->length;
+    while ( rest > 0 ) {
+        const ssize_t bytes = write( fd, it, rest );
+        if ( bytes == -1 ) {
+            if ( errno == EINTR ) continue;
+            return false;
+        }
+        it += bytes;
+        rest -= bytes;
+    }
+    message_clear( message );
     return true;
 }
 
-typedef enum {
-    play_operation_null = 0,
-    play_operation_error,
-    play_operation_invalid,
-    play_operation_pass,
-    play_operation_draw,
-    play_operation_put_left,
-    play_operation_put_right
-} play_operation;
+int64_t now_nanoseconds( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
 
+// buffered reader of a player pipe. bytes after a line are kept for the next call.
 typedef struct {
-    play_operation operation;
-    int16_t card;
-} play_action;
+    int fd;
+    shm_ring *ring;     // read from shared memory instead of the fd when set. the fd tells that the player is gone.
+    size_t begin;
+    size_t end;
+    bool eof;
+    bool timeout;       // the deadline passed before bytes came.
+    int64_t deadline;   // now_nanoseconds() to wait until. 0 waits forever.
+    char buffer[k_max_read_buffer];
+} line_reader;
 
-play_action play_action_make( const play_operation operation, const int16_t card )
+void line_reader_init( line_reader *reader, const int fd )
 {
-    play_action action = { operation, card };
-    return action;
+    reader->fd = fd;
+    reader->ring = NULL;
+    reader->begin = 0;
+    reader->end = 0;
+    reader->eof = false;
+    reader->timeout = false;
+    reader->deadline = 0;
+}
+
+// waits for bytes until the deadline. bytes already in the pipe are taken even after it.
+bool line_reader_wait( line_reader *reader )
+{
+    if ( reader->deadline == 0 ) return true;
+    for ( ;; ) {
+        const int64_t rest = reader->deadline - now_nanoseconds();
+        struct pollfd fds = { reader->fd, POLLIN, 0 };
+        const int ready = poll( &fds, 1, rest > 0 ? (int)( ( rest + 999999 ) / 1000000 ) : 0 );
+        if ( ready > 0 ) return true;
+        if ( ready == -1 && errno == EINTR ) continue;
+        if ( ready == -1 ) return true;    // let read() report it.
+        if ( rest <= 0 || now_nanoseconds() >= reader->deadline ) {
+            reader->timeout = true;
+            return false;
+        }
+    }
 }
 
-bool is_equals_play_action( const play_action a1, const play_action a2 )
+bool line_reader_fill( line_reader *reader )
 {
-    return a1.operation == a2.operation && a1.card == a2.card;
+    if ( reader->eof ) return false;
+    
+    // move rest bytes to head of buffer.
+    if ( reader->begin > 0 ) {
+        memmove( reader->buffer, reader->buffer + reader->begin, reader->end - reader->begin );
+        reader->end -= reader->begin;
+        reader->begin = 0;
+    }
+    if ( reader->end == sizeof( reader->buffer ) ) return false;
+    if ( reader->ring ) {
+        const int32_t bytes = shm_ring_read( reader->ring, reader->buffer + reader->end, sizeof( reader->buffer ) - reader->end, reader->deadline, reader->fd );
+        if ( bytes == -1 ) {
+            reader->timeout = true;
+            return false;
+        }
+        if ( bytes == 0 ) {
+            reader->eof = true;
+            return false;
+        }
+        reader->end += bytes;
+        return true;
+    }
+    if ( ! line_reader_wait( reader ) ) return false;
+    
+    ssize_t bytes;
+    do {
+        bytes = read( reader->fd, reader->buffer + reader->end, sizeof( reader->buffer ) - reader->end );
+    } while ( bytes == -1 && errno == EINTR );
+    
+    if ( bytes <= 0 ) {
+        reader->eof = true;
+        return false;
+    }
+    reader->end += bytes;
+    return true;
 }
 
-void deck_swap( int16_t *v1, int16_t *v2 )
+bool read_line( line_reader *reader, char *line, const size_t max_of_line )
 {
-    int16_t t = *v1;
-    *v1 = *v2;
-    *v2 = t;
+    assert( max_of_line > 0 );
+    size_t bytes = 0;
+    for ( ;; ) {
+        const char *begin = reader->buffer + reader->begin;
+        const char *end = reader->buffer + reader->end;
+        const char *lineend = memchr( begin, '\n', end - begin );
+        const char *copy_end = lineend ? lineend : end;
+        
+        // copy as much as fits, discard the rest of a too long line.
+        size_t copy = copy_end - begin;
+        if ( copy > max_of_line - 1 - bytes ) copy = max_of_line - 1 - bytes;
+        memcpy( line + bytes, begin, copy );
+        bytes += copy;
+        
+        if ( lineend ) {
+            reader->begin += ( lineend - begin ) + 1;
+            line[bytes] = '\0';
+            return true;
+        }
+        reader->begin = reader->end;
+        if ( ! line_reader_fill( reader ) ) return false;
+    }
 }
 
-void deck_shuffle( int16_t *deck, const size_t size )
+bool read_to_lineend( line_reader *reader )
 {
-    for ( size_t i = 0; i < size; i++ ) {
-        deck_swap( deck+i, deck + i + rand()%(size-i) );
+    for ( ;; ) {
+        const char *begin = reader->buffer + reader->begin;
+        const char *lineend = memchr( begin, '\n', reader->end - reader->begin );
+        if ( lineend ) {
+            reader->begin += ( lineend - begin ) + 1;
+            return true;
+        }
+        reader->begin = reader->end;
+        if ( ! line_reader_fill( reader ) ) return false;
     }
 }
 
-bool write_reset( const int fd, const int32_t index_of_games )
+bool read_bytes( line_reader *reader, uint8_t *bytes, size_t size )
 {
-    if ( ! write_line( fd, "RESET" ) ) return false;
-    
-    char line[k_max_line];
-    sprintf( line, "%d", index_of_games );
-    if ( ! write_line( fd, line ) ) return false;
-    
+    while ( size > 0 ) {
+        if ( reader->begin == reader->end && ! line_reader_fill( reader ) ) return false;
+        size_t copy = reader->end - reader->begin;
+        if ( copy > size ) copy = size;
+        memcpy( bytes, reader->buffer + reader->begin, copy );
+        reader->begin += copy;
+        bytes += copy;
+        size -= copy;
+    }
     return true;
 }
 
-bool write_sequence( const int fd, const int16_t *sequence )
+bool write_reset( const int fd, message_buffer *message, const int32_t index_of_games )
 {
-    char line[k_max_line];
-    size_t line_bytes = 0;
-    for ( size_t i = 0; *sequence != 0; i++, sequence++ ) {
-        line_bytes += sprintf( line + line_bytes, "%d ", *sequence );
-    }
-    if ( line_bytes > 0 ) {
-        line[line_bytes-1] = '\0'; // delete tail space character.
-    } else {
-        *line = '\0';
+    message_clear( message );
+    write_line( message, "RESET" );
+    message_append_int( message, index_of_games );
+    message_append( message, "\n", 1 );
+    return message_flush( message, fd );
+}
+
+void write_sequence( message_buffer *message, const int16_t *sequence )
+{
+    for ( const int16_t *it = sequence; *it != 0; it++ ) {
+        if ( it != sequence ) message_append( message, " ", 1 );
+        message_append_int( message, *it );
     }
-    
-    return write_line( fd, line );
+    message_append( message, "\n", 1 );
 }
 
-bool write_play_action( const int fd, const play_action action )
+void write_play_action( message_buffer *message, const play_action action )
 {
     if ( action.operation == play_operation_pass ) {
-        if ( ! write_line( fd, "P" ) ) return false;
+        write_line( message, "P" );
     } else if ( action.operation == play_operation_draw ) {
-        if ( ! write_line( fd, "D" ) ) return false;
+        write_line( message, "D" );
     } else if ( action.operation == play_operation_put_left ) {
-        char line[k_max_line];
-        sprintf( line, "L%d", action.card );
-        if ( ! write_line( fd, line ) ) return false;
+        message_append( message, "L", 1 );
+        message_append_int( message, action.card );
+        message_append( message, "\n", 1 );
     } else if ( action.operation == play_operation_put_right ) {
-        char line[k_max_line];
-        sprintf( line, "R%d", action.card );
-        if ( ! write_line( fd, line ) ) return false;
+        message_append( message, "R", 1 );
+        message_append_int( message, action.card );
+        message_append( message, "\n", 1 );
     } else if ( action.operation == play_operation_null ) {
         // no action previous.
-        if ( ! write_line( fd, "" ) ) return false;
+        write_line( message, "" );
     } else {
         // error action previous.
-        if ( ! write_line( fd, "" ) ) return false;
+        write_line( message, "" );
     }
-    return true;
 }
 
-bool write_play( const int fd, const int32_t index_of_turn, const int16_t *hands_first, const int16_t *hands_second, const int16_t *place_left, const int16_t *place_right, const play_action action_first, const play_action action_second )
+bool write_play( const int fd, message_buffer *message, const int32_t index_of_turn, const int16_t *hands_first, const int16_t *hands_second, const int16_t *place_left, const int16_t *place_right, const play_action action_first, const play_action action_second )
 {
-    if ( ! write_line( fd, "PLAY" ) ) return false;
-    {
-        // write turn.
-        char line[k_max_line];
-        sprintf( line, "%d", index_of_turn );
-        if ( ! write_line( fd, line ) ) return false;
-    }
+    message_clear( message );
+    write_line( message, "PLAY" );
     
-    if ( ! write_sequence( fd, hands_first ) ) false;
-    if ( ! write_sequence( fd, hands_second ) ) false;
-    if ( ! write_sequence( fd, place_left ) ) false;
-    if ( ! write_sequence( fd, place_right ) ) false;
-    if ( ! write_play_action( fd, action_first ) ) false;
-    if ( ! write_play_action( fd, action_second ) ) false;
+    // write turn.
+    message_append_int( message, index_of_turn );
+    message_append( message, "\n", 1 );
     
-    return true;
+    write_sequence( message, hands_first );
+    write_sequence( message, hands_second );
+    write_sequence( message, place_left );
+    write_sequence( message, place_right );
+    write_play_action( message, action_first );
+    write_play_action( message, action_second );
+    
+    return message_flush( message, fd );
+}
+
+bool write_gameset( const int fd, message_buffer *message, const int32_t point_left, const int32_t point_right, const int32_t score_left, const int32_t score_right )
+{
+    message_clear( message );
+    write_line( message, "GAMESET" );
+    
+    message_append_int( message, point_left );
+    message_append( message, " ", 1 );
+    message_append_int( message, point_right );
+    message_append( message, "\n", 1 );
+    
+    message_append_int( message, score_left );
+    message_append( message, " ", 1 );
+    message_append_int( message, score_right );
+    message_append( message, "\n", 1 );
+    
+    return message_flush( message, fd );
 }
 
-bool write_gameset( const int fd, const int32_t point_left, const int32_t point_right, const int32_t score_left, const int32_t score_right )
+play_action read_play( line_reader *reader )
 {
-    if ( ! write_line( fd, "GAMESET" ) ) return false;
+    play_action action = {};
     
     char line[k_max_line];
+    if ( read_line( reader, line, sizeof( line ) ) ) {
+        if ( strcmp( line, "P" ) == 0 ) {
+            action.operation = play_operation_pass;
+        } else if ( strcmp( line, "D" ) == 0  ) {
+            action.operation = play_operation_draw;
+        } else if ( sscanf( line, "L%hi", &action.card ) == 1 ) {
+            action.operation = play_operation_put_left;
+        } else if ( sscanf( line, "R%hi", &action.card ) == 1 ) {
+            action.operation = play_operation_put_right;
+        } else {
+            action.operation = play_operation_invalid;
+        }
+    } else {
+        action.operation = play_operation_error;
+    }
     
-    sprintf( line, "%d %d", point_left, point_right );
-    if ( ! write_line( fd, line ) ) return false;
+    return action;
+}
 
-    sprintf( line, "%d %d", score_left, score_right );
-    if ( ! write_line( fd, line ) ) return false;
+bool write_frame_reset( const int fd, message_buffer *message, const int32_t index_of_games )
+{
+    uint8_t frame[k_protocol_max_frame];
+    message_clear( message );
+    message_append( message, (const char *)frame, protocol_encode_reset( frame, index_of_games ) );
+    return message_flush( message, fd );
+}
 
-    return true;
+bool write_frame_play( const int fd, message_buffer *message, const int32_t index_of_turn, const int16_t *hands_first, const int16_t *hands_second, const int16_t top_left, const int16_t top_right, const play_action action_first, const play_action action_second )
+{
+    uint8_t frame[k_protocol_max_frame];
+    message_clear( message );
+    message_append( message, (const char *)frame, protocol_encode_play( frame, index_of_turn, hands_first, hands_second, top_left, top_right, action_first, action_second ) );
+    return message_flush( message, fd );
 }
 
-int32_t number_of_sequence( const int16_t *sequence )
+bool write_frame_gameset( const int fd, message_buffer *message, const int32_t point_you, const int32_t point_op, const int32_t score_you, const int32_t score_op )
 {
-    int32_t count = 0;
-    while ( *(sequence++) != 0 ) count++;
-    return count;
+    uint8_t frame[k_protocol_max_frame];
+    message_clear( message );
+    message_append( message, (const char *)frame, protocol_encode_gameset( frame, point_you, point_op, score_you, score_op ) );
+    return message_flush( message, fd );
 }
 
-int32_t sum_sequence( const int16_t *sequence )
+bool read_frame_ack( line_reader *reader, const protocol_message type )
 {
-    int32_t sum = 0;
-    while ( *sequence != 0 ) sum += *(sequence++);
-    return sum;
+    uint8_t byte;
+    return read_bytes( reader, &byte, 1 ) && byte == type;
 }
 
-bool index_of_sequence( const int16_t *sequence, const int16_t value, int16_t *index )
+play_action read_frame_play( line_reader *reader )
 {
-    const int16_t *it = sequence;
-    while ( *it != 0 && *it != value ) it++;
-    if ( *it == 0 ) {
-        return false;
-    } else {
-        if ( index ) *index = it - sequence;
-        return true;
+    uint8_t byte;
+    if ( ! read_bytes( reader, &byte, 1 ) ) {
+        return play_action_make( play_operation_error, 0 );
     }
+    return protocol_decode_action( byte );
 }
 
-bool is_member_sequence( const int16_t *sequence, const int16_t member )
+// latencies of a player in nanoseconds. buckets have 8 steps per power of 2.
+typedef struct {
+    int64_t count;
+    int64_t total;      // sum of the moves.
+    int64_t write;      // part of total spent writing requests.
+    int64_t ack;        // waiting for RESET and GAMESET, not in total.
+    int64_t max;
+    int64_t buckets[k_latency_buckets];
+} latency_histogram;
+
+int32_t latency_bucket( const uint64_t nanoseconds )
 {
-    return index_of_sequence( sequence, member, NULL );
+    if ( nanoseconds < 8 ) return (int32_t)nanoseconds;
+#if defined( __GNUC__ ) || defined( __clang__ )
+    const int32_t exponent = 63 - __builtin_clzll( nanoseconds );
+#else
+    int32_t exponent = 3;
+    while ( exponent < 63 && ( nanoseconds >> ( exponent + 1 ) ) != 0 ) exponent++;
+#endif
+    return ( exponent - 2 ) * 8 + (int32_t)( ( nanoseconds >> ( exponent - 3 ) ) & 7 );
 }
 
-void push_sequence( int16_t *sequence, const int16_t value )
+int64_t latency_bucket_value( const int32_t bucket )
 {
-    const int32_t count = number_of_sequence( sequence );
-    memmove( sequence+1, sequence, count * sizeof(int16_t) );
-    *sequence = value;
+    if ( bucket < 8 ) return bucket;
+    return (int64_t)( 8 + bucket % 8 ) << ( bucket / 8 - 1 );
 }
 
-bool pick_sequence( int16_t *sequence, const int16_t value )
+void latency_record( latency_histogram *latency, const int64_t nanoseconds, const int64_t write )
 {
-    int16_t index;
-    if ( index_of_sequence( sequence, value, &index ) ) {
-        const int32_t count = number_of_sequence( sequence );
-        memmove( sequence+index, sequence+index+1, (count - index) * sizeof(int16_t) );
-        return true;
-    } else {
-        return false;
+    const int64_t value = nanoseconds > 0 ? nanoseconds : 0;
+    latency->count++;
+    latency->total += value;
+    latency->write += write;
+    if ( latency->max < value ) latency->max = value;
+    latency->buckets[latency_bucket( value )]++;
+}
+
+void latency_merge( latency_histogram *latency, const latency_histogram *other )
+{
+    latency->count += other->count;
+    latency->total += other->total;
+    latency->write += other->write;
+    latency->ack += other->ack;
+    if ( latency->max < other->max ) latency->max = other->max;
+    for ( int32_t i = 0; i < k_latency_buckets; i++ ) {
+        latency->buckets[i] += other->buckets[i];
     }
 }
 
-int16_t pop_sequence( int16_t *sequence )
+// lower bound of the bucket holding the given fraction of moves.
+int64_t latency_percentile( const latency_histogram *latency, const double fraction )
 {
-    const int32_t count = number_of_sequence( sequence );
-    assert( count > 0 );
+    const int64_t rank = (int64_t)( fraction * latency->count );
+    int64_t count = 0;
+    for ( int32_t i = 0; i < k_latency_buckets; i++ ) {
+        count += latency->buckets[i];
+        if ( count > rank ) return latency_bucket_value( i );
+    }
+    return latency->max;
+}
 
-    const int16_t value = *sequence;
-    memmove( sequence, sequence+1, count * sizeof(int16_t) );
-    return value;
+void print_latency( const char *name, const latency_histogram *latency )
+{
+    fprintf( stdout, "LATENCY %s: MOVES %lld P50 %.1fus P90 %.1fus P99 %.1fus MAX %.1fus TOTAL %.3fs WRITE %.3fs ACK %.3fs\n", name, (long long)latency->count,
+             latency_percentile( latency, 0.50 ) * 1e-3, latency_percentile( latency, 0.90 ) * 1e-3, latency_percentile( latency, 0.99 ) * 1e-3, latency->max * 1e-3,
+             latency->total * 1e-9, latency->write * 1e-9, latency->ack * 1e-9 );
 }
 
-play_action read_play( const int fd )
+// a player. either a child process connected with pipes or a plugin loaded into this process.
+typedef struct {
+    const char *filename;
+    pid_t pid;
+    int fd_in;
+    line_reader reader;
+    message_buffer message;
+    void *library;
+    const slow_plugin *plugin;
+    shm_channel *shm;   // offered with --transport shm until the first RESET, used if the player chose it.
+    bool binary;    // binary frames were chosen at RESET.
+    bool started;   // the first RESET was answered.
+    int64_t deadline;   // of the next reply. 0 waits forever.
+    int32_t pending;    // replies of timed out requests still to come.
+    int32_t timeouts;
+    latency_histogram latency;
+} player;
+
+void player_init( player *p, const char *filename )
 {
-    play_action action = {};
+    memset( p, 0, sizeof( *p ) );
+    p->filename = filename;
+    p->pid = -1;
+    p->fd_in = -1;
+    line_reader_init( &p->reader, -1 );
+}
+
+bool player_launch( player *p, const char *filename, const char *args[] )
+{
+    player_init( p, filename );
     
-    char line[k_max_line];
-    if ( read_line( fd, line, sizeof( line ) ) ) {
-        if ( strcmp( line, "P" ) == 0 ) {
-            action.operation = play_operation_pass;
-        } else if ( strcmp( line, "D" ) == 0  ) {
-            action.operation = play_operation_draw;
-        } else if ( sscanf( line, "L%hi", &action.card ) == 1 ) {
-            action.operation = play_operation_put_left;
-        } else if ( sscanf( line, "R%hi", &action.card ) == 1 ) {
-            action.operation = play_operation_put_right;
-        } else {
-            action.operation = play_operation_invalid;
-        }
-    } else {
-        action.operation = play_operation_error;
+    int fd_in[2];
+    int fd_out[2];
+    if ( pipe( fd_in ) == -1 ) {
+        fprintf( stderr, "error[%s]: pipe に失敗しました(%d).\n", filename, __LINE__ );
+        return false;
+    }
+    if ( pipe( fd_out ) == -1 ) {
+        fprintf( stderr, "error[%s]: pipe に失敗しました(%d).\n", filename, __LINE__ );
+        close( fd_in[0] );
+        close( fd_in[1] );
+        return false;
     }
     
-    return action;
+    int shm_fd = -1;
+    if ( option_transport == transport_shm && ! ( p->shm = shm_create( &shm_fd ) ) ) {
+        fprintf( stderr, "warn[%s]: 共有メモリを作れなかったのでパイプを使います(%d).\n", filename, __LINE__ );
+    }
+    
+    // pipes are not inherited by other players. dup2 in the child clears the flag.
+    for ( int i = 0; i < 2; i++ ) {
+        fcntl( fd_in[i], F_SETFD, FD_CLOEXEC );
+        fcntl( fd_out[i], F_SETFD, FD_CLOEXEC );
+    }
+    
+    if ( option_verbose ) fprintf( stderr, "プロセスを複製します...\n" );
+    p->pid = fork();
+    if ( p->pid == -1 ) {
+        fprintf( stderr, "error[%s]: fork に失敗しました(%d).\n", filename, __LINE__ );
+        return false;
+    }
+    
+    if ( p->pid == 0 ) {
+        // player child process.
+        if ( option_verbose ) fprintf( stderr, "[%s]を実行します...\n", filename );
+        _exit( run_player( filename, args, fd_in[0], fd_out[1], shm_fd ) );
+    }
+    
+    // the mapping stays after the fd is closed.
+    if ( shm_fd != -1 && close( shm_fd ) == -1 ) {
+        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    }
+    
+    if ( close( fd_in[0] ) == -1 ) {
+        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    }
+    if ( close( fd_out[1] ) == -1 ) {
+        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    }
+    p->fd_in = fd_in[1];
+    line_reader_init( &p->reader, fd_out[0] );
+    return true;
 }
 
-static const size_t place_action_put_candidate_max = 10;
-int32_t play_action_put_candidate( play_action *candidates, int16_t *hands, int16_t *place, const play_operation operation )
+bool player_load( player *p, const char *filename )
 {
-    const play_action * const candidate_begin  = candidates;
-    if ( *place == 0 ) {
-        for ( int16_t *it = hands; *it != 0; it++ ) {
-            *(candidates++) = play_action_make( operation, *it );
-        }
-    } else {
-        int16_t upper = *place == 13 ? 1 : *place + 1;
-        int16_t lower = *place == 1 ? 13 : *place - 1;
-        if ( is_member_sequence( hands, upper ) ) {
-            *(candidates++) = play_action_make( operation, upper );
-        }
-        if ( upper != lower && is_member_sequence( hands, lower ) ) {
-            *(candidates++) = play_action_make( operation, lower );
-        }
+    player_init( p, filename );
+    
+    if ( option_verbose ) fprintf( stderr, "[%s]を読み込みます...\n", filename );
+    
+    // each player gets its own namespace so the same library can be loaded twice without sharing globals.
+#ifdef __GLIBC__
+    p->library = dlmopen( LM_ID_NEWLM, filename, RTLD_NOW | RTLD_LOCAL );
+#else
+    p->library = dlopen( filename, RTLD_NOW | RTLD_LOCAL );
+#endif
+    if ( ! p->library ) {
+        fprintf( stderr, "error[%s]: dlopen に失敗しました(%d). %s\n", filename, __LINE__, dlerror() );
+        return false;
+    }
+    
+    const slow_plugin_entry_function entry = (slow_plugin_entry_function)dlsym( p->library, SLOW_PLUGIN_ENTRY );
+    if ( ! entry ) {
+        fprintf( stderr, "error[%s]: %s が見つかりません(%d).\n", filename, SLOW_PLUGIN_ENTRY, __LINE__ );
+        return false;
     }
     
-    return (int32_t)( candidates - candidate_begin );
+    p->plugin = entry( SLOW_PLUGIN_VERSION );
+    if ( ! p->plugin || p->plugin->version != SLOW_PLUGIN_VERSION ) {
+        fprintf( stderr, "error[%s]: バージョン %d に対応していません(%d).\n", filename, SLOW_PLUGIN_VERSION, __LINE__ );
+        p->plugin = NULL;
+        return false;
+    }
+    return true;
 }
 
-static const size_t play_action_candidate_max = 12;
-int32_t play_action_candidates( play_action *candidates, const play_action previous, const int16_t *deck, int16_t* hands, const ssize_t max_hands, int16_t *place_left, int16_t *place_right )
+void player_close( player *p )
 {
-    const play_action * const candidate_begin  = candidates;
+    if ( option_verbose && p->filename ) fprintf( stderr, "[%s]プレイヤーを終了します...\n", p->filename );
     
-    if ( previous.operation == play_operation_pass ) {
-        for ( int16_t *it = hands; *it != 0; it++ ) {
-            *(candidates++) = play_action_make( play_operation_put_left, *it );
-            *(candidates++) = play_action_make( play_operation_put_right, *it );
-        }
+    // a player still owing replies may never read the end of its input.
+    if ( p->pid > 0 && p->pending > 0 ) {
+        kill( p->pid, SIGTERM );
+    }
+    if ( p->shm ) {
+        shm_ring_close( &p->shm->to_player );
+        shm_detach( p->shm );
+    }
+    if ( p->fd_in != -1 && close( p->fd_in ) == -1 ) {
+        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    }
+    if ( p->reader.fd != -1 && close( p->reader.fd ) == -1 ) {
+        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    }
+    if ( p->library && dlclose( p->library ) != 0 ) {
+        fprintf( stderr, "warn: dlclose に失敗しました(%d).\n", __LINE__ );
+    }
+    p->fd_in = -1;
+    p->reader.fd = -1;
+    p->library = NULL;
+    p->plugin = NULL;
+    p->shm = NULL;
+}
+
+slow_plugin_action plugin_action_make( const play_action action )
+{
+    slow_plugin_action result = { slow_plugin_operation_none, action.card };
+    if ( action.operation == play_operation_pass ) {
+        result.operation = slow_plugin_operation_pass;
+    } else if ( action.operation == play_operation_draw ) {
+        result.operation = slow_plugin_operation_draw;
+    } else if ( action.operation == play_operation_put_left ) {
+        result.operation = slow_plugin_operation_put_left;
+    } else if ( action.operation == play_operation_put_right ) {
+        result.operation = slow_plugin_operation_put_right;
     } else {
-        candidates += play_action_put_candidate( candidates, hands, place_left, play_operation_put_left );
-        candidates += play_action_put_candidate( candidates, hands, place_right, play_operation_put_right );
+        result.card = 0;
     }
-    
-    if ( number_of_sequence( hands ) < max_hands && number_of_sequence( deck ) > 0 ) {
-        *(candidates++) = play_action_make( play_operation_draw, 0 );
+    return result;
+}
+
+play_action play_action_from_plugin( const slow_plugin_action action )
+{
+    if ( action.operation == slow_plugin_operation_pass ) {
+        return play_action_make( play_operation_pass, 0 );
+    } else if ( action.operation == slow_plugin_operation_draw ) {
+        return play_action_make( play_operation_draw, 0 );
+    } else if ( action.operation == slow_plugin_operation_put_left ) {
+        return play_action_make( play_operation_put_left, action.card );
+    } else if ( action.operation == slow_plugin_operation_put_right ) {
+        return play_action_make( play_operation_put_right, action.card );
+    } else {
+        return play_action_make( play_operation_invalid, action.card );
     }
-    
-    if ( previous.operation != play_operation_pass || (candidates - candidate_begin) == 0 ) {
-        *(candidates++) = play_action_make( play_operation_pass, 0 );
+}
+
+// skips the replies of timed out requests, then waits for this one until the deadline.
+// the first RESET has no deadline since the player chooses the protocol in its reply.
+bool player_expect_reply( player *p )
+{
+    p->reader.deadline = p->started ? p->deadline : 0;
+    p->reader.timeout = false;
+    while ( p->pending > 0 ) {
+        uint8_t byte;
+        if ( ! ( p->binary ? read_bytes( &p->reader, &byte, 1 ) : read_to_lineend( &p->reader ) ) ) return false;
+        p->pending--;
     }
+    return true;
+}
+
+// counts a reply that did not come in time. it is skipped when it comes.
+bool player_timed_out( player *p )
+{
+    if ( ! p->reader.timeout ) return false;
+    p->pending++;
+    p->timeouts++;
+    fprintf( stderr, "warn[%s]: 制限時間内に応答がありませんでした.\n", p->filename );
+    return true;
+}
+
+bool player_send_reset( player *p, const int32_t index_of_games )
+{
+    if ( p->binary ) return write_frame_reset( p->fd_in, &p->message, index_of_games );
+    return write_reset( p->fd_in, &p->message, index_of_games );
+}
+
+// the player may choose binary frames, or binary frames over shared memory, in reply to the first RESET.
+bool player_receive_reset( player *p )
+{
+    if ( p->binary ) return read_frame_ack( &p->reader, protocol_message_reset );
     
-    return (int32_t)(candidates - candidate_begin);
+    char line[k_max_line];
+    if ( ! read_line( &p->reader, line, sizeof( line ) ) ) return false;
+    if ( ! p->started && strcmp( line, SLOW_PROTOCOL_BINARY ) == 0 ) {
+        if ( option_verbose ) fprintf( stderr, "[%s]バイナリのプロトコルを使います.\n", p->filename );
+        p->binary = true;
+    }
+    if ( ! p->started && p->shm && strcmp( line, SLOW_PROTOCOL_SHM ) == 0 ) {
+        if ( option_verbose ) fprintf( stderr, "[%s]共有メモリを使います.\n", p->filename );
+        p->binary = true;
+        p->reader.ring = &p->shm->to_server;
+        p->message.ring = &p->shm->to_player;
+    } else if ( ! p->started && p->shm ) {
+        shm_detach( p->shm );
+        p->shm = NULL;
+    }
+    p->started = true;
+    return true;
 }
 
-bool is_member_play_actions( const play_action *actions, const play_action member, const size_t size )
+bool player_reset_request( player *p, const int32_t index_of_games )
 {
-    for ( ssize_t i = 0; i < size; i++ ) {
-        if ( is_equals_play_action( actions[i], member ) ) return true;
+    if ( p->plugin ) {
+        p->plugin->reset( index_of_games );
+        return true;
     }
-    return false;
+    if ( ! player_send_reset( p, index_of_games ) ) return false;
+    return ( player_expect_reply( p ) && player_receive_reset( p ) ) || player_timed_out( p );
 }
 
-void play_draw( int16_t *deck, int16_t *hands )
+bool player_reset( player *p, const int32_t index_of_games )
 {
-    const int16_t card = pop_sequence( deck );
-    push_sequence( hands, card );
+    if ( option_latency == latency_none ) return player_reset_request( p, index_of_games );
+    const int64_t begin = now_nanoseconds();
+    const bool result = player_reset_request( p, index_of_games );
+    p->latency.ack += now_nanoseconds() - begin;
+    return result;
 }
 
-void play_put( int16_t *hands, int16_t *place, const int16_t card )
+bool player_send_play( player *p, const int32_t index_of_turn, const int16_t *hands_first, const int16_t *hands_second, const int16_t *place_left, const int16_t *place_right, const play_action action_first, const play_action action_second )
 {
-    const bool picked = pick_sequence( hands, card );
-    assert( picked );
-    push_sequence( place, card );
+    if ( p->binary ) {
+        return write_frame_play( p->fd_in, &p->message, index_of_turn, hands_first, hands_second, *place_left, *place_right, action_first, action_second );
+    }
+    return write_play( p->fd_in, &p->message, index_of_turn, hands_first, hands_second, place_left, place_right, action_first, action_second );
 }
 
-play_action play( play_action action, const play_action previous, int16_t *deck, int16_t *hands, const ssize_t max_hands, int16_t *place_left, int16_t *place_right )
+play_action player_receive_play( player *p )
 {
-    play_action candidates[play_action_candidate_max] = {};
-    const int32_t number_of_candidates = play_action_candidates( candidates, previous, deck, hands, max_hands, place_left, place_right );
-    assert( number_of_candidates > 0 );
-    
-    if ( ! is_member_play_actions( candidates, action, number_of_candidates ) ) {
-        // select force an action in candidtes.
-        fprintf( stderr, "warn: そのプレイヤーの行動はできません. 自動的に行動は選択されます.\n" );
-        action = candidates[0];
+    return p->binary ? read_frame_play( &p->reader ) : read_play( &p->reader );
+}
+
+play_action player_play_request( player *p, const int32_t index_of_turn, const int16_t *hands_first, const int16_t *hands_second, const int16_t *place_left, const int16_t *place_right, const play_action action_first, const play_action action_second, int64_t *written )
+{
+    if ( p->plugin ) {
+        const slow_plugin_action action = p->plugin->play( index_of_turn, hands_first, hands_second, place_left, place_right, plugin_action_make( action_first ), plugin_action_make( action_second ) );
+        return play_action_from_plugin( action );
     }
     
-    if ( action.operation == play_operation_pass ) {
-        // no operation.
-    } else if ( action.operation == play_operation_draw ) {
-        play_draw( deck, hands );
-    } else if ( action.operation == play_operation_put_left ) {
-        play_put( hands, place_left, action.card );
-    } else if ( action.operation == play_operation_put_right ) {
-        play_put( hands, place_right, action.card );
-    } else {
-        fprintf( stderr, "error: 存在しない行動です.\n" );
-        assert( 0 );
+    if ( ! player_send_play( p, index_of_turn, hands_first, hands_second, place_left, place_right, action_first, action_second ) ) {
+        return play_action_make( play_operation_error, 0 );
     }
+    if ( written ) *written = now_nanoseconds();
     
+    play_action action = play_action_make( play_operation_error, 0 );
+    if ( player_expect_reply( p ) ) {
+        action = player_receive_play( p );
+    }
+    if ( action.operation == play_operation_error && player_timed_out( p ) ) {
+        action = play_action_make( play_operation_timeout, 0 );
+    }
     return action;
 }
 
-bool game_is_end( const int16_t *deck_p1, const int16_t *deck_p2, const int16_t *hands_p1, const int16_t *hands_p2 )
+// times the round trip of a move when latencies are measured.
+play_action player_play( player *p, const int32_t index_of_turn, const int16_t *hands_first, const int16_t *hands_second, const int16_t *place_left, const int16_t *place_right, const play_action action_first, const play_action action_second )
 {
-    return (*deck_p1 == 0 && *hands_p1 == 0) || (*deck_p2 == 0 && *hands_p2 == 0 );
+    if ( option_latency == latency_none ) {
+        return player_play_request( p, index_of_turn, hands_first, hands_second, place_left, place_right, action_first, action_second, NULL );
+    }
+    const int64_t begin = now_nanoseconds();
+    int64_t written = begin;
+    const play_action action = player_play_request( p, index_of_turn, hands_first, hands_second, place_left, place_right, action_first, action_second, &written );
+    latency_record( &p->latency, now_nanoseconds() - begin, written - begin );
+    return action;
 }
 
-void print_hands( FILE *fp, const int16_t *hands )
+bool player_send_gameset( player *p, const int32_t point_you, const int32_t point_op, const int32_t score_you, const int32_t score_op )
 {
-    while ( *hands != 0 ) {
-        fprintf( fp, "%d ", *(hands++) );
-    }
+    if ( p->binary ) return write_frame_gameset( p->fd_in, &p->message, point_you, point_op, score_you, score_op );
+    return write_gameset( p->fd_in, &p->message, point_you, point_op, score_you, score_op );
 }
 
-void print_action( FILE *fp, const play_action action )
+bool player_receive_gameset( player *p )
 {
-    if ( action.operation == play_operation_pass ) {
-        fprintf( fp, "パス" );
-    } else if ( action.operation == play_operation_draw ) {
-        fprintf( fp, "山札から１枚引く" );
-    } else if ( action.operation == play_operation_put_left ) {
-        fprintf( fp, "左に %d を置く", action.card );
-    } else if ( action.operation == play_operation_put_right ) {
-        fprintf( fp, "右に %d を置く", action.card );
-    } else {
-        fprintf( fp, "未定義の行動 %d", action.card );
+    return p->binary ? read_frame_ack( &p->reader, protocol_message_gameset ) : read_to_lineend( &p->reader );
+}
+
+bool player_gameset_request( player *p, const int32_t point_you, const int32_t point_op, const int32_t score_you, const int32_t score_op )
+{
+    if ( p->plugin ) {
+        p->plugin->gameset( point_you, score_you, point_op, score_op );
+        return true;
     }
+    if ( ! player_send_gameset( p, point_you, point_op, score_you, score_op ) ) return false;
+    return ( player_expect_reply( p ) && player_receive_gameset( p ) ) || player_timed_out( p );
 }
 
-int run_game( const int p1_in, const int p1_out, const int p2_in, const int p2_out )
+bool player_gameset( player *p, const int32_t point_you, const int32_t point_op, const int32_t score_you, const int32_t score_op )
 {
-    if ( option_verbose ) fprintf( stderr, "ゲームを初期化します...\n" );
-    
-    // score of total games.
-    int32_t score_p1 = 0;
-    int32_t score_p2 = 0;
-    
-    for ( int32_t index_of_game = 0; index_of_game < option_number_of_games; index_of_game++ ) {
-        if ( option_verbose ) fprintf( stderr, "第 %000d ゲームを開始\n", index_of_game+1 );
-
-        // deck.
-        int16_t deck_p1[] = {1,2,3,4,5,6,7,8,9,10,11,12,13,1,2,3,4,5,6,7,8,9,10,11,12,13,0};
-        int16_t deck_p2[] = {1,2,3,4,5,6,7,8,9,10,11,12,13,1,2,3,4,5,6,7,8,9,10,11,12,13,0};
-        const size_t max_number_of_deck = sizeof( deck_p1 ) / sizeof( deck_p1[0] );
-        const int32_t max_number_of_cars_in_deck_p1 = number_of_sequence( deck_p1 );
-        const int32_t max_number_of_cars_in_deck_p2 = number_of_sequence( deck_p2 );
-        assert( max_number_of_cars_in_deck_p1 == max_number_of_cars_in_deck_p2 );
-        assert( memcmp( deck_p1, deck_p2, sizeof( deck_p1 ) ) == 0 );
-        deck_shuffle( deck_p1, number_of_sequence( deck_p1 ) );
-        deck_shuffle( deck_p2, number_of_sequence( deck_p2 ) );
-        
-        // hands.
-        const size_t max_number_of_hands = 5;
-        int16_t hands_p1[max_number_of_hands+1] = {};
-        int16_t hands_p2[max_number_of_hands+1] = {};
-        
-        // place. 0 terminated.
-        int16_t place_left[max_number_of_deck*2] = {};
-        int16_t place_right[max_number_of_deck*2] = {};
-        
-        // last turn action.
-        play_action last_p1 = {};
-        play_action last_p2 = {};
-        
-        if ( ! write_reset( p1_in, index_of_game ) ) return EXIT_FAILURE;
-        if ( ! read_to_lineend( p1_out ) ) return EXIT_FAILURE;
+    if ( option_latency == latency_none ) return player_gameset_request( p, point_you, point_op, score_you, score_op );
+    const int64_t begin = now_nanoseconds();
+    const bool result = player_gameset_request( p, point_you, point_op, score_you, score_op );
+    p->latency.ack += now_nanoseconds() - begin;
+    return result;
+}
+
+// writes game logs to stdout on its own thread. jobs hand over whole buffers so the game loop does not wait for stdout.
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_ready;
+    pthread_cond_t cond_space;
+    pthread_t thread;
+    bool running;
+    bool closed;
+    size_t length;
+    char *buffer;       // filled by jobs.
+    char *writing;      // written by the thread.
+} log_writer;
+
+static log_writer game_log_writer = {};
 
-        if ( ! write_reset( p2_in, index_of_game ) ) return EXIT_FAILURE;
-        if ( ! read_to_lineend( p2_out ) ) return EXIT_FAILURE;
+void *run_log_writer( void *argument )
+{
+    log_writer *writer = argument;
+    pthread_mutex_lock( &writer->mutex );
+    for ( ;; ) {
+        while ( writer->length == 0 && ! writer->closed ) {
+            pthread_cond_wait( &writer->cond_ready, &writer->mutex );
+        }
+        if ( writer->length == 0 ) break;
         
-        for ( int32_t index_of_turn = 0; ! game_is_end( deck_p1, deck_p2, hands_p1, hands_p2 ); index_of_turn++ ) {
-
-            // print game.
-            {
-                fprintf( stdout, "ターン数: %d\n", index_of_turn+1 );
-                fprintf( stdout, "場: 左%d 右%d\n", *place_left, *place_right );
-                fprintf( stdout, "P1の手札: " );
-                print_hands( stdout, hands_p1 );
-                fprintf( stdout, "\n" );
-                fprintf( stdout, "P2の手札: " );
-                print_hands( stdout, hands_p2 );
-                fprintf( stdout, "\n" );
-            }
-            
-            if ( (index_of_turn + index_of_game) % 2 == 0 ) {
-                if ( ! write_play( p1_in, index_of_turn, hands_p1, hands_p2, place_left, place_right, last_p1, last_p2 ) ) {
-                    return EXIT_FAILURE;
-                }
-                
-                const play_action action = read_play( p1_out );
-                if ( action.operation == play_operation_error ) {
-                    return EXIT_FAILURE;
-                }
-                
-                last_p1 = play( action, last_p1, deck_p1, hands_p1, max_number_of_hands, place_left, place_right );
-                
-                // print result.
-                {
-                    fprintf( stdout, "P1の行動: " );
-                    print_action( stdout, last_p1 );
-                    fprintf( stdout, "\n\n" );
-                }
-            } else {
-                if ( ! write_play( p2_in, index_of_turn, hands_p2, hands_p1, place_left, place_right, last_p2, last_p1 ) ) {
-                    return EXIT_FAILURE;
-                }
-                
-                const play_action action = read_play( p2_out );
-                if ( action.operation == play_operation_error ) {
-                    return EXIT_FAILURE;
-                }
-                
-                last_p2 = play( action, last_p2, deck_p2, hands_p2, max_number_of_hands, place_left, place_right );
-                // print result.
-                {
-                    fprintf( stdout, "P2の行動: " );
-                    print_action( stdout, last_p2 );
-                    fprintf( stdout, "\n\n" );
-                }
+        // swap buffers and write without the lock.
+        char *bytes = writer->buffer;
+        size_t rest = writer->length;
+        writer->buffer = writer->writing;
+        writer->writing = bytes;
+        writer->length = 0;
+        pthread_cond_broadcast( &writer->cond_space );
+        pthread_mutex_unlock( &writer->mutex );
+        
+        while ( rest > 0 ) {
+            const ssize_t written = write( STDOUT_FILENO, bytes, rest );
+            if ( written == -1 ) {
+                if ( errno == EINTR ) continue;
+                fprintf( stderr, "warn: write に失敗しました(%d).\n", __LINE__ );
+                break;
             }
+            bytes += written;
+            rest -= written;
         }
+        pthread_mutex_lock( &writer->mutex );
+    }
+    pthread_mutex_unlock( &writer->mutex );
+    return NULL;
+}
+
+bool log_writer_start( log_writer *writer )
+{
+    writer->buffer = malloc( k_max_log_writer_buffer );
+    writer->writing = malloc( k_max_log_writer_buffer );
+    if ( ! writer->buffer || ! writer->writing ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    
+    // the lock is only used while the thread runs.
+    pthread_mutex_init( &writer->mutex, NULL );
+    pthread_cond_init( &writer->cond_ready, NULL );
+    pthread_cond_init( &writer->cond_space, NULL );
+
+    // text printed by stdio before must come first.
+    fflush( stdout );
+    if ( pthread_create( &writer->thread, NULL, run_log_writer, writer ) != 0 ) {
+        fprintf( stderr, "error: pthread_create に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    writer->running = true;
+    return true;
+}
+
+void log_writer_submit( log_writer *writer, const char *bytes, size_t length )
+{
+    if ( ! writer->running ) {
+        fwrite( bytes, 1, length, stdout );
+        return;
+    }
+    pthread_mutex_lock( &writer->mutex );
+    while ( length > 0 ) {
+        // waits only when the thread is behind by a whole buffer.
+        while ( writer->length == k_max_log_writer_buffer ) {
+            pthread_cond_wait( &writer->cond_space, &writer->mutex );
+        }
+        size_t bytes_to_copy = k_max_log_writer_buffer - writer->length;
+        if ( bytes_to_copy > length ) bytes_to_copy = length;
+        memcpy( writer->buffer + writer->length, bytes, bytes_to_copy );
+        writer->length += bytes_to_copy;
+        bytes += bytes_to_copy;
+        length -= bytes_to_copy;
+        pthread_cond_signal( &writer->cond_ready );
+    }
+    pthread_mutex_unlock( &writer->mutex );
+}
+
+void log_writer_stop( log_writer *writer )
+{
+    if ( writer->running ) {
+        pthread_mutex_lock( &writer->mutex );
+        writer->closed = true;
+        pthread_cond_signal( &writer->cond_ready );
+        pthread_mutex_unlock( &writer->mutex );
+        pthread_join( writer->thread, NULL );
+        pthread_cond_destroy( &writer->cond_space );
+        pthread_cond_destroy( &writer->cond_ready );
+        pthread_mutex_destroy( &writer->mutex );
+        writer->running = false;
+    }
+    free( writer->buffer );
+    free( writer->writing );
+    writer->buffer = NULL;
+    writer->writing = NULL;
+}
+
+// log text of a job. handed to the writer at the end of each game.
+typedef struct {
+    size_t length;
+    char buffer[k_max_log_buffer];
+} log_buffer;
+
+void log_flush( log_buffer *log )
+{
+    log_writer_submit( &game_log_writer, log->buffer, log->length );
+    log->length = 0;
+}
+
+void log_printf( log_buffer *log, const char *format, ... )
+{
+    for ( ;; ) {
+        va_list arguments;
+        va_start( arguments, format );
+        const size_t rest = sizeof( log->buffer ) - log->length;
+        const int bytes = vsnprintf( log->buffer + log->length, rest, format, arguments );
+        va_end( arguments );
+        if ( bytes < 0 ) return;
+        if ( (size_t)bytes < rest ) {
+            log->length += bytes;
+            return;
+        }
+        if ( log->length == 0 ) return;  // too long for the buffer.
+        log_flush( log );
+    }
+}
+
+void print_hands( log_buffer *log, const int16_t *hands )
+{
+    while ( *hands != 0 ) {
+        log_printf( log, "%d ", *(hands++) );
+    }
+}
+
+void print_action( log_buffer *log, const play_action action )
+{
+    if ( action.operation == play_operation_pass ) {
+        log_printf( log, "パス" );
+    } else if ( action.operation == play_operation_draw ) {
+        log_printf( log, "山札から１枚引く" );
+    } else if ( action.operation == play_operation_put_left ) {
+        log_printf( log, "左に %d を置く", action.card );
+    } else if ( action.operation == play_operation_put_right ) {
+        log_printf( log, "右に %d を置く", action.card );
+    } else {
+        log_printf( log, "未定義の行動 %d", action.card );
+    }
+}
+
+// actions of a game for the replay file.
+typedef struct {
+    uint8_t *actions;
+    int32_t number_of_actions;
+    int32_t capacity;
+} replay_buffer;
+
+bool replay_append( replay_buffer *replay, const play_action action )
+{
+    if ( replay->number_of_actions == replay->capacity ) {
+        const int32_t capacity = replay->capacity ? replay->capacity * 2 : 256;
+        uint8_t *actions = realloc( replay->actions, capacity );
+        if ( ! actions ) {
+            fprintf( stderr, "error: realloc に失敗しました(%d).\n", __LINE__ );
+            return false;
+        }
+        replay->actions = actions;
+        replay->capacity = capacity;
+    }
+    replay->actions[replay->number_of_actions++] = protocol_encode_action( action );
+    return true;
+}
+
+// appends games to the replay file in the order they end, and writes the index on close.
+typedef struct {
+    pthread_mutex_t mutex;
+    FILE *file;
+    uint64_t offset;
+    uint64_t *offsets;      // file offset of each record. 0 if not written.
+    int32_t number_of_records;
+} replay_writer;
+
+static replay_writer game_replay_writer = { PTHREAD_MUTEX_INITIALIZER, NULL, 0, NULL, 0 };
+
+bool replay_writer_open( replay_writer *writer, const char *filename, const int32_t number_of_records )
+{
+    writer->offsets = calloc( number_of_records, sizeof( uint64_t ) );
+    if ( ! writer->offsets ) {
+        fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    writer->file = fopen( filename, "wb" );
+    if ( ! writer->file ) {
+        fprintf( stderr, "error: %s を開けませんでした(%d).\n", filename, __LINE__ );
+        return false;
+    }
+    
+    // the header is written again with the index offset on close.
+    uint8_t header[k_record_header_size];
+    record_encode_header( header, number_of_records, 0 );
+    writer->number_of_records = number_of_records;
+    writer->offset = fwrite( header, 1, sizeof( header ), writer->file );
+    return writer->offset == sizeof( header );
+}
+
+bool replay_writer_submit( replay_writer *writer, const int32_t index_of_record, const record_game *game )
+{
+    uint8_t header[k_record_game_size];
+    record_encode_game( header, game );
+    
+    pthread_mutex_lock( &writer->mutex );
+    writer->offsets[index_of_record] = writer->offset;
+    bool written = fwrite( header, 1, sizeof( header ), writer->file ) == sizeof( header );
+    written = written && fwrite( game->actions, 1, game->number_of_actions, writer->file ) == (size_t)game->number_of_actions;
+    writer->offset += sizeof( header ) + game->number_of_actions;
+    pthread_mutex_unlock( &writer->mutex );
+    
+    if ( ! written ) fprintf( stderr, "error: リプレイの書き込みに失敗しました(%d).\n", __LINE__ );
+    return written;
+}
+
+bool replay_writer_close( replay_writer *writer )
+{
+    if ( ! writer->file ) return true;
+    
+    bool written = true;
+    uint8_t bytes[8];
+    for ( int32_t i = 0; i < writer->number_of_records; i++ ) {
+        for ( int32_t j = 0; j < 8; j++ ) bytes[j] = (uint8_t)( writer->offsets[i] >> ( j * 8 ) );
+        written = written && fwrite( bytes, 1, sizeof( bytes ), writer->file ) == sizeof( bytes );
+    }
+    uint8_t header[k_record_header_size];
+    record_encode_header( header, writer->number_of_records, writer->offset );
+    written = written && fseek( writer->file, 0, SEEK_SET ) == 0;
+    written = written && fwrite( header, 1, sizeof( header ), writer->file ) == sizeof( header );
+    written = ( fclose( writer->file ) == 0 ) && written;
+    if ( ! written ) fprintf( stderr, "error: リプレイの書き込みに失敗しました(%d).\n", __LINE__ );
+    
+    free( writer->offsets );
+    writer->file = NULL;
+    writer->offsets = NULL;
+    return written;
+}
+
+// decision of the sequential probability ratio test.
+typedef enum {
+    sprt_none = 0,  // keep playing.
+    sprt_h0,        // P1 is not stronger by --sprt points.
+    sprt_h1         // P1 is stronger by --sprt points.
+} sprt_verdict;
+
+#ifndef SLOW_SERVER_NO_MAIN
+static const char *k_sprt_verdict_names[] = { "NONE", "H0", "H1" };
+#endif
+static const int32_t k_sprt_min_games = 32;    // the variance is estimated from the games, so a few are needed first.
+
+// sequential probability ratio test on the points of P1 per game.
+// games end out of order with jobs, so the test takes them in order of index and the verdict does not depend on timing.
+typedef struct {
+    int32_t *points;            // points of P1 by game index.
+    bool *ended;
+    int32_t number_of_games;    // games taken by the test.
+    int32_t number_of_ended;    // games ended, including the ones after the verdict.
+    double sum;
+    double sum_of_squares;
+    double llr;                 // log likelihood ratio of H1 to H0.
+    sprt_verdict verdict;
+} sprt_test;
+
+bool sprt_open( sprt_test *test, const int32_t number_of_games )
+{
+    memset( test, 0, sizeof( *test ) );
+    test->points = calloc( number_of_games, sizeof( int32_t ) );
+    test->ended = calloc( number_of_games, sizeof( bool ) );
+    if ( ! test->points || ! test->ended ) {
+        fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    return true;
+}
+
+void sprt_close( sprt_test *test )
+{
+    free( test->points );
+    free( test->ended );
+    test->points = NULL;
+    test->ended = NULL;
+}
+
+double sprt_lower_bound( void )
+{
+    return log( option_sprt_beta / ( 1 - option_sprt_alpha ) );
+}
+
+double sprt_upper_bound( void )
+{
+    return log( ( 1 - option_sprt_beta ) / option_sprt_alpha );
+}
+
+// points are normal with the variance of the games so far. H0 is a mean of 0, H1 of --sprt.
+void sprt_update( sprt_test *test, const int32_t points )
+{
+    const double n = ++test->number_of_games;
+    test->sum += points;
+    test->sum_of_squares += (double)points * points;
+    if ( test->number_of_games < k_sprt_min_games ) return;
+    
+    const double variance = ( test->sum_of_squares - test->sum * test->sum / n ) / ( n - 1 );
+    if ( variance <= 0 ) return;
+    const double mean_h0 = 0;
+    const double mean_h1 = option_sprt;
+    test->llr = ( mean_h1 - mean_h0 ) * ( test->sum - n * ( mean_h0 + mean_h1 ) / 2 ) / variance;
+    if ( test->llr <= sprt_lower_bound() ) test->verdict = sprt_h0;
+    if ( test->llr >= sprt_upper_bound() ) test->verdict = sprt_h1;
+}
+
+// takes the games ended so far in order of index until a verdict.
+void sprt_report( sprt_test *test, const int32_t index_of_game, const int32_t points )
+{
+    test->points[index_of_game] = points;
+    test->ended[index_of_game] = true;
+    test->number_of_ended++;
+    while ( test->verdict == sprt_none && test->number_of_games < option_number_of_games && test->ended[test->number_of_games] ) {
+        sprt_update( test, test->points[test->number_of_games] );
+    }
+}
+
+// decks of --deals. every dispatcher reads them.
+static deal_file game_deal_file = {};
+
+// hands out game indices and their decks to the jobs in order of index.
+typedef struct {
+    pthread_mutex_t mutex;
+    int32_t index_of_next_game;
+    deal_source deals;  // decks of the seed or of game_deal_file, dealt in blocks.
+    sprt_test *sprt;    // stops handing out games at its verdict when set.
+} game_dispatcher;
+
+bool dispatcher_open( game_dispatcher *dispatcher )
+{
+    if ( ! deal_source_init( &dispatcher->deals, option_seed, option_deals ? &game_deal_file : NULL, k_deal_block_games ) ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    return true;
+}
+
+bool dispatch_game( game_dispatcher *dispatcher, int32_t *index_of_game, int16_t *deck_p1, int16_t *deck_p2 )
+{
+    pthread_mutex_lock( &dispatcher->mutex );
+    const bool stopped = dispatcher->sprt && dispatcher->sprt->verdict != sprt_none;
+    bool has_game = ! stopped && dispatcher->index_of_next_game < option_number_of_games;
+    if ( has_game ) {
+        // the deck of game i depends only on the seed and i, or is the i-th of the file.
+        const int16_t *decks = deal_source_decks( &dispatcher->deals, dispatcher->index_of_next_game );
+        has_game = decks != NULL;
+        if ( has_game ) {
+            *index_of_game = dispatcher->index_of_next_game++;
+            memcpy( deck_p1, decks, k_number_of_deck * sizeof( int16_t ) );
+            memcpy( deck_p2, decks + k_number_of_deck, k_number_of_deck * sizeof( int16_t ) );
+        }
+    }
+    pthread_mutex_unlock( &dispatcher->mutex );
+    return has_game;
+}
+
+// hands the points of P1 in an ended game to the test.
+void report_game( game_dispatcher *dispatcher, const int32_t index_of_game, const int32_t points_p1 )
+{
+    if ( ! dispatcher->sprt ) return;
+    pthread_mutex_lock( &dispatcher->mutex );
+    sprt_report( dispatcher->sprt, index_of_game, points_p1 );
+    pthread_mutex_unlock( &dispatcher->mutex );
+}
+
+// deadline of a request sent at begin. moves are also limited by the rest of the clock.
+int64_t player_deadline( const int64_t begin, const int64_t clock, const bool move )
+{
+    int64_t deadline = 0;
+    if ( option_move_time > 0 ) deadline = begin + option_move_time * 1000000LL;
+    if ( move && option_clock > 0 && ( deadline == 0 || begin + clock < deadline ) ) deadline = begin + clock;
+    return deadline;
+}
+
+// prints the state before a move.
+void print_turn( log_buffer *log, const game_state *state, const int16_t *hands_p1, const int16_t *hands_p2 )
+{
+    if ( option_output < output_turn ) return;
+    log_printf( log, "ターン数: %d\n", state->index_of_turn+1 );
+    log_printf( log, "場: 左%d 右%d\n", place_top( &state->left ), place_top( &state->right ) );
+    log_printf( log, "P1の手札: " );
+    print_hands( log, hands_p1 );
+    log_printf( log, "\n" );
+    log_printf( log, "P2の手札: " );
+    print_hands( log, hands_p2 );
+    log_printf( log, "\n" );
+}
+
+// applies the reply of the player to move. a timed out player loses the game under forfeit.
+bool apply_turn( game_state *state, const play_action action, log_buffer *log, replay_buffer *replay, int32_t *forfeit )
+{
+    const int32_t index_of_player = game_turn_player( state );
+    if ( action.operation == play_operation_timeout ) {
+        if ( option_output >= output_turn ) {
+            log_printf( log, index_of_player == 0 ? "P1は時間切れです.\n" : "P2は時間切れです.\n" );
+        }
+        if ( option_timeout == timeout_forfeit ) {
+            // a null action closes the game in the replay.
+            *forfeit = index_of_player;
+            return ! replay || replay_append( replay, play_action_make( play_operation_null, 0 ) );
+        }
+    }
+    
+    const play_action played = game_apply( state, action );
+    if ( ! is_equals_play_action( played, action ) && action.operation != play_operation_timeout ) {
+        fprintf( stderr, "warn: そのプレイヤーの行動はできません. 自動的に行動は選択されます.\n" );
+    }
+    if ( replay && ! replay_append( replay, played ) ) {
+        return false;
+    }
+    
+    // print result.
+    if ( option_output >= output_turn ) {
+        log_printf( log, index_of_player == 0 ? "P1の行動: " : "P2の行動: " );
+        print_action( log, played );
+        log_printf( log, "\n\n" );
+    }
+    return true;
+}
+
+// adds the points of an ended game to the scores.
+void score_game( const game_state *state, const int32_t forfeit, log_buffer *log, int32_t *points_p1, int32_t *points_p2, int32_t *score_p1, int32_t *score_p2 )
+{
+    if ( forfeit >= 0 ) {
+        game_forfeit_points( state, forfeit, points_p1, points_p2 );
+    } else {
+        game_points( state, points_p1, points_p2 );
+    }
+    
+    *score_p1 += *points_p1;
+    *score_p2 += *points_p2;
+    
+    // print score.
+    if ( option_output >= output_game ) {
+        log_printf( log, "P1 POINTS: %d / %d\n", *points_p1, *score_p1 );
+        log_printf( log, "P2 POINTS: %d / %d\n", *points_p2, *score_p2 );
+    }
+}
+
+int run_game( player *p1, player *p2, const int32_t index_of_game, const int16_t *deck_p1, const int16_t *deck_p2, log_buffer *log, replay_buffer *replay, int32_t *score_p1, int32_t *score_p2 )
+{
+    if ( option_verbose ) fprintf( stderr, "第 %d ゲームを開始\n", index_of_game+1 );
+    
+    game_state state;
+    game_init( &state, deck_p1, deck_p2, index_of_game % 2 );
+    
+    // hands as sequences for messages. 0 terminated.
+    int16_t hands_p1[k_max_hands+1] = {};
+    int16_t hands_p2[k_max_hands+1] = {};
+    
+    // clocks of the players for this game.
+    const bool limited = option_move_time > 0 || option_clock > 0;
+    int64_t clocks[2] = { option_clock * 1000000LL, option_clock * 1000000LL };
+    int32_t forfeit = -1;
+    
+    p1->deadline = player_deadline( now_nanoseconds(), 0, false );
+    if ( ! player_reset( p1, index_of_game ) ) return EXIT_FAILURE;
+    p2->deadline = player_deadline( now_nanoseconds(), 0, false );
+    if ( ! player_reset( p2, index_of_game ) ) return EXIT_FAILURE;
+    
+    while ( forfeit < 0 && ! game_is_end( &state ) ) {
+        hands_sequence( &state.players[0], hands_p1 );
+        hands_sequence( &state.players[1], hands_p2 );
+        const int16_t *place_left = place_sequence( &state.left );
+        const int16_t *place_right = place_sequence( &state.right );
+        const int32_t index_of_turn = state.index_of_turn;
+        print_turn( log, &state, hands_p1, hands_p2 );
+        
+        const int32_t index_of_player = game_turn_player( &state );
+        const int64_t begin = limited ? now_nanoseconds() : 0;
+        play_action action;
+        if ( index_of_player == 0 ) {
+            p1->deadline = player_deadline( begin, clocks[0], true );
+            action = player_play( p1, index_of_turn, hands_p1, hands_p2, place_left, place_right, state.previous[0], state.previous[1] );
+        } else {
+            p2->deadline = player_deadline( begin, clocks[1], true );
+            action = player_play( p2, index_of_turn, hands_p2, hands_p1, place_left, place_right, state.previous[1], state.previous[0] );
+        }
+        if ( action.operation == play_operation_error ) {
+            return EXIT_FAILURE;
+        }
+        if ( option_clock > 0 ) {
+            clocks[index_of_player] -= now_nanoseconds() - begin;
+            if ( clocks[index_of_player] < 0 ) clocks[index_of_player] = 0;
+        }
+        if ( ! apply_turn( &state, action, log, replay, &forfeit ) ) {
+            return EXIT_FAILURE;
+        }
+    }
+    
+    int32_t points_p1;
+    int32_t points_p2;
+    score_game( &state, forfeit, log, &points_p1, &points_p2, score_p1, score_p2 );
+    
+    p1->deadline = player_deadline( now_nanoseconds(), 0, false );
+    if ( ! player_gameset( p1, points_p1, points_p2, *score_p1, *score_p2 ) ) {
+        return EXIT_FAILURE;
+    }
+    p2->deadline = player_deadline( now_nanoseconds(), 0, false );
+    if ( ! player_gameset( p2, points_p2, points_p1, *score_p2, *score_p1 ) ) {
+        return EXIT_FAILURE;
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+// one job plays games between a pair of players.
+typedef struct {
+    player *p1;
+    player *p2;
+    game_dispatcher *dispatcher;
+    const char *label;      // printed before each game when set.
+    int32_t index_of_record;    // record of the first game in the replay file.
+    int64_t overhead;           // nanoseconds of games not spent waiting for players.
+    int32_t score_p1;
+    int32_t score_p2;
+    int exit_code;
+} match_job;
+
+void *run_match( void *argument )
+{
+    match_job *job = argument;
+    job->exit_code = EXIT_SUCCESS;
+    
+    // a game is handed to the log writer at once so games of jobs are not mixed.
+    log_buffer *log = malloc( sizeof( log_buffer ) );
+    if ( ! log ) {
+        fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+        job->exit_code = EXIT_FAILURE;
+        return NULL;
+    }
+    log->length = 0;
+    
+    replay_buffer replay = {};
+    replay_buffer *job_replay = game_replay_writer.file ? &replay : NULL;
+    
+    int32_t index_of_game;
+    record_game record = {};
+    while ( dispatch_game( job->dispatcher, &index_of_game, record.deck_p1, record.deck_p2 ) ) {
+        if ( job->label && option_output >= output_game ) log_printf( log, "%s\n", job->label );
+        const int32_t score_p1 = job->score_p1;
+        const int32_t score_p2 = job->score_p2;
+        const int64_t wait_p1 = job->p1->latency.total + job->p1->latency.ack;
+        const int64_t wait_p2 = job->p2->latency.total + job->p2->latency.ack;
+        const int64_t begin = option_latency != latency_none ? now_nanoseconds() : 0;
+        replay.number_of_actions = 0;
+        job->exit_code = run_game( job->p1, job->p2, index_of_game, record.deck_p1, record.deck_p2, log, job_replay, &job->score_p1, &job->score_p2 );
         
-        {
-            const int32_t sum_p1 = sum_sequence( deck_p1 ) + sum_sequence( hands_p1 );
-            const int32_t sum_p2 = sum_sequence( deck_p2 ) + sum_sequence( hands_p2 );
-            int32_t points_p1 = 0;
-            int32_t points_p2 = 0;
-            if ( sum_p1 == 0 ) {
-                points_p1 += sum_p2;
-                points_p2 -= sum_p2;
+        // the rest of the game time is spent in the server.
+        if ( option_latency != latency_none ) {
+            const int64_t time_p1 = job->p1->latency.total + job->p1->latency.ack - wait_p1;
+            const int64_t time_p2 = job->p2->latency.total + job->p2->latency.ack - wait_p2;
+            const int64_t overhead = now_nanoseconds() - begin - time_p1 - time_p2;
+            job->overhead += overhead;
+            if ( option_latency >= latency_game && option_output >= output_game ) {
+                log_printf( log, "TIME: P1 %.3fms P2 %.3fms SERVER %.3fms\n", time_p1 * 1e-6, time_p2 * 1e-6, overhead * 1e-6 );
             }
-            if ( sum_p2 == 0 ) {
-                points_p1 -= sum_p1;
-                points_p2 += sum_p1;
+        }
+        log_flush( log );
+        if ( job->exit_code != EXIT_SUCCESS ) break;
+        report_game( job->dispatcher, index_of_game, job->score_p1 - score_p1 );
+        
+        if ( job_replay ) {
+            record.index_of_game = index_of_game;
+            record.first = index_of_game % 2;
+            record.points_p1 = job->score_p1 - score_p1;
+            record.points_p2 = job->score_p2 - score_p2;
+            record.number_of_actions = replay.number_of_actions;
+            record.actions = replay.actions;
+            if ( ! replay_writer_submit( &game_replay_writer, job->index_of_record + index_of_game, &record ) ) {
+                job->exit_code = EXIT_FAILURE;
+                break;
             }
-            
-            score_p1 += points_p1;
-            score_p2 += points_p2;
-            
-            // print score.
-            {
-                fprintf( stdout, "P1 POINTS: %d / %d\n", points_p1, score_p1 );
-                fprintf( stdout, "P2 POINTS: %d / %d\n", points_p2, score_p2 );
+        }
+    }
+    
+    free( replay.actions );
+    free( log );
+    return NULL;
+}
+
+// a game of a batch. the games of a job advance together, each by one move per BATCHPLAY.
+typedef struct {
+    bool active;
+    int32_t index_of_game;
+    int32_t forfeit;
+    game_state state;
+    record_game record;
+    replay_buffer replay;
+    log_buffer *log;
+} batch_game;
+
+// replies a player owes for a message of the batch. acks come in the order of the frames, then the actions.
+typedef struct {
+    uint8_t acks[k_protocol_max_batch * 2];
+    int32_t number_of_acks;
+    batch_game *moves[k_protocol_max_batch];
+    int32_t number_of_moves;
+    uint8_t entries[k_protocol_max_batch * k_protocol_batch_play_entry_size];
+} batch_request;
+
+player *batch_player( match_job *job, const int32_t side )
+{
+    return side == 0 ? job->p1 : job->p2;
+}
+
+// starts the next game in the slot and adds its RESET to the messages. the first RESET chooses the protocol, so it is sent alone.
+bool batch_start( match_job *job, batch_game *game, batch_request *requests )
+{
+    game->active = dispatch_game( job->dispatcher, &game->index_of_game, game->record.deck_p1, game->record.deck_p2 );
+    if ( ! game->active ) return true;
+    if ( option_verbose ) fprintf( stderr, "第 %d ゲームを開始\n", game->index_of_game+1 );
+    
+    game_init( &game->state, game->record.deck_p1, game->record.deck_p2, game->index_of_game % 2 );
+    game->forfeit = -1;
+    game->replay.number_of_actions = 0;
+    
+    uint8_t frame[k_protocol_max_frame];
+    const size_t size = protocol_encode_reset( frame, game->index_of_game );
+    for ( int32_t side = 0; side < 2; side++ ) {
+        player *p = batch_player( job, side );
+        if ( ! p->started ) {
+            if ( ! player_reset( p, game->index_of_game ) ) return false;
+            if ( ! p->binary ) {
+                fprintf( stderr, "error[%s]: --batch にはバイナリのプロトコルが必要です(%d).\n", p->filename, __LINE__ );
+                return false;
+            }
+            continue;
+        }
+        message_append( &p->message, (const char *)frame, size );
+        requests[side].acks[requests[side].number_of_acks++] = protocol_message_reset;
+    }
+    return true;
+}
+
+// scores the ended game, adds its GAMESET to the messages and hands it to the log and replay writers.
+bool batch_end( match_job *job, batch_game *game, batch_request *requests )
+{
+    int32_t points_p1;
+    int32_t points_p2;
+    score_game( &game->state, game->forfeit, game->log, &points_p1, &points_p2, &job->score_p1, &job->score_p2 );
+    game->active = false;
+    
+    uint8_t frame[k_protocol_max_frame];
+    message_append( &job->p1->message, (const char *)frame, protocol_encode_batch_gameset( frame, game->index_of_game, points_p1, points_p2, job->score_p1, job->score_p2 ) );
+    message_append( &job->p2->message, (const char *)frame, protocol_encode_batch_gameset( frame, game->index_of_game, points_p2, points_p1, job->score_p2, job->score_p1 ) );
+    requests[0].acks[requests[0].number_of_acks++] = protocol_message_batch_gameset;
+    requests[1].acks[requests[1].number_of_acks++] = protocol_message_batch_gameset;
+    
+    // other games of the batch end in the meantime, so the points are not the change of the job scores.
+    if ( game->log ) log_flush( game->log );
+    report_game( job->dispatcher, game->index_of_game, points_p1 );
+    if ( ! game_replay_writer.file ) return true;
+    
+    record_game *record = &game->record;
+    record->index_of_game = game->index_of_game;
+    record->first = game->index_of_game % 2;
+    record->points_p1 = points_p1;
+    record->points_p2 = points_p2;
+    record->number_of_actions = game->replay.number_of_actions;
+    record->actions = game->replay.actions;
+    return replay_writer_submit( &game_replay_writer, job->index_of_record + game->index_of_game, record );
+}
+
+// adds the position of the game to the BATCHPLAY of the player to move.
+void batch_add_move( batch_game *game, batch_request *requests )
+{
+    const game_state *state = &game->state;
+    int16_t hands_p1[k_max_hands+1] = {};
+    int16_t hands_p2[k_max_hands+1] = {};
+    hands_sequence( &state->players[0], hands_p1 );
+    hands_sequence( &state->players[1], hands_p2 );
+    print_turn( game->log, state, hands_p1, hands_p2 );
+    
+    const int32_t side = game_turn_player( state );
+    batch_request *request = &requests[side];
+    uint8_t *entry = request->entries + request->number_of_moves * k_protocol_batch_play_entry_size;
+    const int16_t top_left = place_top( &state->left );
+    const int16_t top_right = place_top( &state->right );
+    if ( side == 0 ) {
+        protocol_encode_batch_play_entry( entry, game->index_of_game, state->index_of_turn, hands_p1, hands_p2, top_left, top_right, state->previous[0], state->previous[1] );
+    } else {
+        protocol_encode_batch_play_entry( entry, game->index_of_game, state->index_of_turn, hands_p2, hands_p1, top_left, top_right, state->previous[1], state->previous[0] );
+    }
+    request->moves[request->number_of_moves++] = game;
+}
+
+// sends the message of the cycle to the player. the BATCHPLAY comes after the RESET and GAMESET frames.
+bool batch_send( player *p, const batch_request *request )
+{
+    if ( request->number_of_moves > 0 ) {
+        uint8_t header[k_protocol_batch_play_header_size];
+        message_append( &p->message, (const char *)header, protocol_encode_batch_play_header( header, request->number_of_moves ) );
+        message_append( &p->message, (const char *)request->entries, request->number_of_moves * k_protocol_batch_play_entry_size );
+    }
+    return p->message.length == 0 || message_flush( &p->message, p->fd_in );
+}
+
+// reads the acks and the actions of the player, and plays the actions in their games.
+bool batch_receive( player *p, const batch_request *request )
+{
+    uint8_t replies[k_protocol_max_batch * 3];
+    const int32_t size = request->number_of_acks + request->number_of_moves;
+    if ( ! read_bytes( &p->reader, replies, size ) ) return false;
+    if ( memcmp( replies, request->acks, request->number_of_acks ) != 0 ) return false;
+    
+    replay_buffer *replay = NULL;
+    for ( int32_t i = 0; i < request->number_of_moves; i++ ) {
+        batch_game *game = request->moves[i];
+        if ( game_replay_writer.file ) replay = &game->replay;
+        const play_action action = protocol_decode_action( replies[request->number_of_acks + i] );
+        if ( ! apply_turn( &game->state, action, game->log, replay, &game->forfeit ) ) return false;
+    }
+    return true;
+}
+
+// plays option_batch games at once between the pair of the job. each cycle sends one message to each player and reads its replies.
+// both players are asked before either is read, so they think at the same time.
+void *run_batch( void *argument )
+{
+    match_job *job = argument;
+    job->exit_code = EXIT_SUCCESS;
+    
+    batch_game *games = calloc( option_batch, sizeof( batch_game ) );
+    batch_request *requests = calloc( 2, sizeof( batch_request ) );
+    bool ready = games && requests;
+    if ( ! ready ) fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
+    for ( int32_t i = 0; ready && i < option_batch && option_output > output_silent; i++ ) {
+        // a game is handed to the log writer at once so games of the batch are not mixed.
+        games[i].log = malloc( sizeof( log_buffer ) );
+        if ( ! games[i].log ) {
+            fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+            ready = false;
+            break;
+        }
+        games[i].log->length = 0;
+    }
+    
+    // every slot starts a game in the first cycle. a slot whose game has ended starts the next one.
+    bool running = ready;
+    bool dispatched = true;
+    while ( running ) {
+        for ( int32_t side = 0; side < 2; side++ ) {
+            message_clear( &batch_player( job, side )->message );
+            requests[side].number_of_acks = 0;
+            requests[side].number_of_moves = 0;
+        }
+        int32_t number_of_active = 0;
+        for ( int32_t i = 0; running && i < option_batch; i++ ) {
+            batch_game *game = &games[i];
+            if ( game->active && ( game->forfeit >= 0 || game_is_end( &game->state ) ) ) {
+                running = batch_end( job, game, requests );
+            }
+            if ( running && ! game->active && dispatched ) {
+                running = batch_start( job, game, requests );
+                dispatched = game->active;
+            }
+            if ( running && game->active ) {
+                batch_add_move( game, requests );
+                number_of_active++;
+            }
+        }
+        
+        // the last GAMESET frames are sent without moves.
+        for ( int32_t side = 0; running && side < 2; side++ ) {
+            running = batch_send( batch_player( job, side ), &requests[side] );
+        }
+        for ( int32_t side = 0; running && side < 2; side++ ) {
+            running = batch_receive( batch_player( job, side ), &requests[side] );
+        }
+        if ( ! running ) {
+            fprintf( stderr, "error: 対戦を続けられません(%d).\n", __LINE__ );
+            job->exit_code = EXIT_FAILURE;
+        }
+        if ( number_of_active == 0 ) break;
+    }
+    if ( ! ready ) job->exit_code = EXIT_FAILURE;
+    
+    for ( int32_t i = 0; games && i < option_batch; i++ ) {
+        free( games[i].replay.actions );
+        free( games[i].log );
+    }
+    free( requests );
+    free( games );
+    return NULL;
+}
+
+// runs jobs on their own threads. a single job runs on the calling thread.
+int run_jobs( match_job *jobs, const int32_t number_of_jobs )
+{
+    void *(*run)( void * ) = option_batch > 0 ? run_batch : run_match;
+    if ( number_of_jobs == 1 ) {
+        run( &jobs[0] );
+        return jobs[0].exit_code;
+    }
+    
+    int exit_code = EXIT_SUCCESS;
+    pthread_t *threads = calloc( number_of_jobs, sizeof( pthread_t ) );
+    int32_t number_of_threads = 0;
+    for ( ; threads && number_of_threads < number_of_jobs; number_of_threads++ ) {
+        if ( pthread_create( &threads[number_of_threads], NULL, run, &jobs[number_of_threads] ) != 0 ) {
+            fprintf( stderr, "error: pthread_create に失敗しました(%d).\n", __LINE__ );
+            break;
+        }
+    }
+    if ( number_of_threads < number_of_jobs ) {
+        // stop handing out games, started jobs finish their current game.
+        exit_code = EXIT_FAILURE;
+        for ( int32_t i = 0; i < number_of_jobs; i++ ) {
+            pthread_mutex_lock( &jobs[i].dispatcher->mutex );
+            jobs[i].dispatcher->index_of_next_game = option_number_of_games;
+            pthread_mutex_unlock( &jobs[i].dispatcher->mutex );
+        }
+    }
+    
+    for ( int32_t i = 0; i < number_of_threads; i++ ) {
+        pthread_join( threads[i], NULL );
+        if ( jobs[i].exit_code != EXIT_SUCCESS ) exit_code = jobs[i].exit_code;
+    }
+    free( threads );
+    return exit_code;
+}
+
+// readiness of the player pipes for the event loop. epoll on linux, poll elsewhere.
+// a pipe is registered with a key, and ready keys are returned until its bytes are read.
+typedef struct {
+#ifdef __linux__
+    int fd;
+#else
+    struct pollfd *fds;     // indexed by key. fd -1 is skipped.
+    int32_t number_of_keys;
+    int32_t next;           // key to start scanning from, so no pipe starves.
+#endif
+} event_poller;
+
+bool event_poller_open( event_poller *poller, const int32_t number_of_keys )
+{
+#ifdef __linux__
+    (void)number_of_keys;   // epoll grows as pipes are added.
+    poller->fd = epoll_create1( EPOLL_CLOEXEC );
+    if ( poller->fd == -1 ) {
+        fprintf( stderr, "error: epoll_create1 に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+#else
+    poller->fds = calloc( number_of_keys, sizeof( struct pollfd ) );
+    if ( ! poller->fds ) {
+        fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+    for ( int32_t i = 0; i < number_of_keys; i++ ) poller->fds[i].fd = -1;
+    poller->number_of_keys = number_of_keys;
+    poller->next = 0;
+#endif
+    return true;
+}
+
+bool event_poller_add( event_poller *poller, const int32_t key, const int fd )
+{
+#ifdef __linux__
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = (uint32_t)key;
+    if ( epoll_ctl( poller->fd, EPOLL_CTL_ADD, fd, &event ) == -1 ) {
+        fprintf( stderr, "error: epoll_ctl に失敗しました(%d).\n", __LINE__ );
+        return false;
+    }
+#else
+    poller->fds[key].fd = fd;
+    poller->fds[key].events = POLLIN;
+#endif
+    return true;
+}
+
+void event_poller_remove( event_poller *poller, const int32_t key, const int fd )
+{
+#ifdef __linux__
+    (void)key;
+    epoll_ctl( poller->fd, EPOLL_CTL_DEL, fd, NULL );
+#else
+    (void)fd;
+    poller->fds[key].fd = -1;
+#endif
+}
+
+// waits for ready pipes. @return number of keys, or -1 on an error.
+int32_t event_poller_wait( event_poller *poller, int32_t *keys, const int32_t max_of_keys )
+{
+#ifdef __linux__
+    struct epoll_event events[k_max_events];
+    int ready;
+    do {
+        ready = epoll_wait( poller->fd, events, max_of_keys < k_max_events ? max_of_keys : k_max_events, -1 );
+    } while ( ready == -1 && errno == EINTR );
+    for ( int i = 0; i < ready; i++ ) keys[i] = (int32_t)events[i].data.u32;
+    return ready;
+#else
+    int ready;
+    do {
+        ready = poll( poller->fds, poller->number_of_keys, -1 );
+    } while ( ready == -1 && errno == EINTR );
+    if ( ready == -1 ) return -1;
+    int32_t number_of_keys = 0;
+    for ( int32_t i = 0; i < poller->number_of_keys && number_of_keys < max_of_keys; i++ ) {
+        const int32_t key = ( poller->next + i ) % poller->number_of_keys;
+        if ( poller->fds[key].fd != -1 && poller->fds[key].revents != 0 ) keys[number_of_keys++] = key;
+    }
+    poller->next = ( poller->next + 1 ) % poller->number_of_keys;
+    return number_of_keys;
+#endif
+}
+
+void event_poller_close( event_poller *poller )
+{
+#ifdef __linux__
+    if ( poller->fd != -1 ) close( poller->fd );
+    poller->fd = -1;
+#else
+    free( poller->fds );
+    poller->fds = NULL;
+#endif
+}
+
+// true when a whole reply is buffered, so reading it does not block.
+bool line_reader_ready( const line_reader *reader, const bool binary )
+{
+    if ( reader->begin == reader->end ) return false;
+    if ( binary ) return true;
+    if ( memchr( reader->buffer + reader->begin, '\n', reader->end - reader->begin ) ) return true;
+    
+    // a line longer than the buffer is read and discarded by read_line().
+    return reader->begin == 0 && reader->end == sizeof( reader->buffer );
+}
+
+// where a session waits in the steps of run_game().
+typedef enum {
+    session_reset,      // for the RESET acks of both players.
+    session_play,       // for the move of the player to move.
+    session_gameset,    // for the GAMESET acks of both players.
+    session_done
+} session_step;
+
+// a game of the event loop. run_game() cut at each reply so many games wait on their players at once.
+typedef struct {
+    match_job *job;
+    session_step step;
+    int32_t waiting;        // bits of the players whose reply is still to come.
+    int32_t index_of_game;
+    int32_t forfeit;
+    int32_t score_p1;       // scores before the game.
+    int32_t score_p2;
+    int64_t sent[2];        // now_nanoseconds() of the requests, for latencies.
+    int64_t written;
+    game_state state;
+    record_game record;
+    replay_buffer replay;
+    log_buffer *log;
+} game_session;
+
+player *session_player( game_session *session, const int32_t side )
+{
+    return side == 0 ? session->job->p1 : session->job->p2;
+}
+
+// sends RESET of the next game to both players. the session is done when no game is left.
+bool session_start( game_session *session )
+{
+    match_job *job = session->job;
+    if ( ! dispatch_game( job->dispatcher, &session->index_of_game, session->record.deck_p1, session->record.deck_p2 ) ) {
+        session->step = session_done;
+        return true;
+    }
+    if ( option_verbose ) fprintf( stderr, "第 %d ゲームを開始\n", session->index_of_game+1 );
+    
+    game_init( &session->state, session->record.deck_p1, session->record.deck_p2, session->index_of_game % 2 );
+    session->forfeit = -1;
+    session->score_p1 = job->score_p1;
+    session->score_p2 = job->score_p2;
+    session->replay.number_of_actions = 0;
+    session->step = session_reset;
+    session->waiting = 3;
+    for ( int32_t side = 0; side < 2; side++ ) {
+        if ( option_latency != latency_none ) session->sent[side] = now_nanoseconds();
+        if ( ! player_send_reset( session_player( session, side ), session->index_of_game ) ) return false;
+    }
+    return true;
+}
+
+// sends PLAY to the player to move, or GAMESET to both when the game has ended.
+bool session_next_turn( game_session *session )
+{
+    match_job *job = session->job;
+    game_state *state = &session->state;
+    if ( session->forfeit < 0 && ! game_is_end( state ) ) {
+        int16_t hands_p1[k_max_hands+1] = {};
+        int16_t hands_p2[k_max_hands+1] = {};
+        hands_sequence( &state->players[0], hands_p1 );
+        hands_sequence( &state->players[1], hands_p2 );
+        const int16_t *place_left = place_sequence( &state->left );
+        const int16_t *place_right = place_sequence( &state->right );
+        print_turn( session->log, state, hands_p1, hands_p2 );
+        
+        const int32_t side = game_turn_player( state );
+        session->step = session_play;
+        session->waiting = 1 << side;
+        if ( option_latency != latency_none ) session->sent[side] = now_nanoseconds();
+        bool sent;
+        if ( side == 0 ) {
+            sent = player_send_play( job->p1, state->index_of_turn, hands_p1, hands_p2, place_left, place_right, state->previous[0], state->previous[1] );
+        } else {
+            sent = player_send_play( job->p2, state->index_of_turn, hands_p2, hands_p1, place_left, place_right, state->previous[1], state->previous[0] );
+        }
+        if ( option_latency != latency_none ) session->written = now_nanoseconds();
+        return sent;
+    }
+    
+    int32_t points_p1;
+    int32_t points_p2;
+    score_game( state, session->forfeit, session->log, &points_p1, &points_p2, &job->score_p1, &job->score_p2 );
+    
+    session->step = session_gameset;
+    session->waiting = 3;
+    if ( option_latency != latency_none ) session->sent[0] = session->sent[1] = now_nanoseconds();
+    return player_send_gameset( job->p1, points_p1, points_p2, job->score_p1, job->score_p2 )
+        && player_send_gameset( job->p2, points_p2, points_p1, job->score_p2, job->score_p1 );
+}
+
+// hands the ended game to the log and replay writers.
+bool session_end_game( game_session *session )
+{
+    match_job *job = session->job;
+    if ( session->log ) log_flush( session->log );
+    report_game( job->dispatcher, session->index_of_game, job->score_p1 - session->score_p1 );
+    if ( ! game_replay_writer.file ) return true;
+    
+    record_game *record = &session->record;
+    record->index_of_game = session->index_of_game;
+    record->first = session->index_of_game % 2;
+    record->points_p1 = job->score_p1 - session->score_p1;
+    record->points_p2 = job->score_p2 - session->score_p2;
+    record->number_of_actions = session->replay.number_of_actions;
+    record->actions = session->replay.actions;
+    return replay_writer_submit( &game_replay_writer, job->index_of_record + session->index_of_game, record );
+}
+
+// takes a buffered reply of a player and sends the next request.
+bool session_receive( game_session *session, const int32_t side )
+{
+    player *p = session_player( session, side );
+    if ( ( session->waiting & ( 1 << side ) ) == 0 ) {
+        // nothing was asked of the player.
+        p->reader.begin = p->reader.end;
+        return true;
+    }
+    session->waiting &= ~( 1 << side );
+    const int64_t now = option_latency != latency_none ? now_nanoseconds() : 0;
+    
+    if ( session->step == session_reset ) {
+        if ( ! player_receive_reset( p ) ) return false;
+        p->latency.ack += now - session->sent[side];
+        return session->waiting != 0 || session_next_turn( session );
+    }
+    if ( session->step == session_play ) {
+        const play_action action = player_receive_play( p );
+        if ( action.operation == play_operation_error ) return false;
+        if ( option_latency != latency_none ) latency_record( &p->latency, now - session->sent[side], session->written - session->sent[side] );
+        replay_buffer *replay = game_replay_writer.file ? &session->replay : NULL;
+        return apply_turn( &session->state, action, session->log, replay, &session->forfeit ) && session_next_turn( session );
+    }
+    if ( session->step == session_gameset ) {
+        if ( ! player_receive_gameset( p ) ) return false;
+        p->latency.ack += now - session->sent[side];
+        return session->waiting != 0 || ( session_end_game( session ) && session_start( session ) );
+    }
+    return false;
+}
+
+// each session keeps four pipes open.
+void raise_file_limit( void )
+{
+    struct rlimit limit;
+    if ( getrlimit( RLIMIT_NOFILE, &limit ) == 0 && limit.rlim_cur < limit.rlim_max ) {
+        limit.rlim_cur = limit.rlim_max;
+        if ( setrlimit( RLIMIT_NOFILE, &limit ) == -1 ) fprintf( stderr, "warn: setrlimit に失敗しました(%d).\n", __LINE__ );
+    }
+}
+
+// plays the games of all jobs at once on this thread. each job is a session driven by the replies of its players.
+int run_sessions( match_job *jobs, const int32_t number_of_sessions )
+{
+    game_session *sessions = calloc( number_of_sessions, sizeof( game_session ) );
+    int32_t *keys = calloc( number_of_sessions * 2, sizeof( int32_t ) );
+    event_poller poller;
+    if ( ! sessions || ! keys ) {
+        fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
+        free( sessions );
+        free( keys );
+        return EXIT_FAILURE;
+    }
+    if ( ! event_poller_open( &poller, number_of_sessions * 2 ) ) {
+        free( sessions );
+        free( keys );
+        return EXIT_FAILURE;
+    }
+    
+    int exit_code = EXIT_SUCCESS;
+    int32_t number_of_active = 0;
+    for ( int32_t i = 0; i < number_of_sessions; i++ ) {
+        game_session *session = &sessions[i];
+        session->job = &jobs[i];
+        session->step = session_done;
+        jobs[i].exit_code = EXIT_SUCCESS;
+        if ( option_output > output_silent ) {
+            session->log = malloc( sizeof( log_buffer ) );
+            if ( ! session->log ) {
+                fprintf( stderr, "error: malloc に失敗しました(%d).\n", __LINE__ );
+                exit_code = EXIT_FAILURE;
+                break;
             }
+            session->log->length = 0;
+        }
+        if ( ! event_poller_add( &poller, i*2, jobs[i].p1->reader.fd ) || ! event_poller_add( &poller, i*2+1, jobs[i].p2->reader.fd ) ) {
+            exit_code = EXIT_FAILURE;
+            break;
+        }
+        if ( ! session_start( session ) ) {
+            fprintf( stderr, "error[%s]: 第 %d ゲームを続けられません(%d).\n", jobs[i].p1->filename, session->index_of_game+1, __LINE__ );
+            jobs[i].exit_code = EXIT_FAILURE;
+            session->step = session_done;
+        }
+        if ( session->step == session_done ) {
+            event_poller_remove( &poller, i*2, jobs[i].p1->reader.fd );
+            event_poller_remove( &poller, i*2+1, jobs[i].p2->reader.fd );
+        } else {
+            number_of_active++;
+        }
+    }
+    
+    // the time between waits is spent in the server.
+    int64_t begin = option_latency != latency_none ? now_nanoseconds() : 0;
+    while ( exit_code == EXIT_SUCCESS && number_of_active > 0 ) {
+        if ( option_latency != latency_none ) jobs[0].overhead += now_nanoseconds() - begin;
+        const int32_t number_of_keys = event_poller_wait( &poller, keys, number_of_sessions * 2 );
+        if ( option_latency != latency_none ) begin = now_nanoseconds();
+        if ( number_of_keys < 0 ) {
+            fprintf( stderr, "error: 応答の待機に失敗しました(%d).\n", __LINE__ );
+            exit_code = EXIT_FAILURE;
+            break;
+        }
+        
+        for ( int32_t k = 0; k < number_of_keys; k++ ) {
+            game_session *session = &sessions[keys[k] / 2];
+            const int32_t side = keys[k] % 2;
+            if ( session->step == session_done ) continue;
             
-            if ( ! write_gameset( p1_in, points_p1, points_p2, score_p1, score_p2 ) ) {
-                return EXIT_FAILURE;
+            // one read does not block on a ready pipe. a reply may take several.
+            player *p = session_player( session, side );
+            line_reader_fill( &p->reader );
+            bool running = true;
+            while ( running && session->step != session_done && line_reader_ready( &p->reader, p->binary ) ) {
+                running = session_receive( session, side );
             }
-            if ( ! read_to_lineend( p1_out ) ) {
-                return EXIT_FAILURE;
+            if ( running && p->reader.eof && session->step != session_done ) {
+                running = false;
+            }
+            if ( ! running ) {
+                fprintf( stderr, "error[%s]: 第 %d ゲームを続けられません(%d).\n", p->filename, session->index_of_game+1, __LINE__ );
+                session->job->exit_code = EXIT_FAILURE;
+                session->step = session_done;
             }
+            if ( session->step == session_done ) {
+                event_poller_remove( &poller, keys[k] / 2 * 2, session->job->p1->reader.fd );
+                event_poller_remove( &poller, keys[k] / 2 * 2 + 1, session->job->p2->reader.fd );
+                number_of_active--;
+            }
+        }
+    }
+    
+    for ( int32_t i = 0; i < number_of_sessions; i++ ) {
+        if ( jobs[i].exit_code != EXIT_SUCCESS ) exit_code = jobs[i].exit_code;
+        free( sessions[i].replay.actions );
+        free( sessions[i].log );
+    }
+    event_poller_close( &poller );
+    free( keys );
+    free( sessions );
+    return exit_code;
+}
+
+// round robin of the league players. every player process is kept alive for all its pairings.
+int run_league( void )
+{
+    const int32_t n = option_number_of_league;
+    player *players = calloc( n, sizeof( player ) );
+    int32_t *table = calloc( n * n, sizeof( int32_t ) );
+    match_job *jobs = calloc( n, sizeof( match_job ) );
+    game_dispatcher *dispatchers = calloc( n, sizeof( game_dispatcher ) );
+    char (*labels)[k_max_line] = calloc( n, sizeof( *labels ) );
+    if ( ! players || ! table || ! jobs || ! dispatchers || ! labels ) {
+        fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
+        return EXIT_FAILURE;
+    }
+    
+    const char *no_arguments[k_max_arg+1] = {};
+    bool ready = true;
+    for ( int32_t i = 0; i < n; i++ ) player_init( &players[i], NULL );
+    for ( int32_t i = 0; ready && i < n; i++ ) {
+        ready = dispatcher_open( &dispatchers[i] );
+    }
+    for ( int32_t i = 0; ready && i < n; i++ ) {
+        ready = player_launch( &players[i], option_league[i], no_arguments );
+    }
+    if ( ready && option_output > output_silent ) {
+        ready = log_writer_start( &game_log_writer );
+    }
+    if ( ready && option_replay ) {
+        ready = replay_writer_open( &game_replay_writer, option_replay, n * ( n-1 ) / 2 * option_number_of_games );
+    }
+    
+    // circle method. with an odd number of players, index n is a bye.
+    const int32_t m = n + n % 2;
+    int32_t *order = calloc( m, sizeof( int32_t ) );
+    for ( int32_t i = 0; order && i < m; i++ ) order[i] = i;
+    int exit_code = ready && order ? EXIT_SUCCESS : EXIT_FAILURE;
+    int32_t index_of_pairing = 0;
+    int64_t overhead = 0;
+    
+    for ( int32_t round = 0; exit_code == EXIT_SUCCESS && round < m-1; round++ ) {
+        // pairings of a round share no player, so they can run at once.
+        int32_t number_of_pairings = 0;
+        for ( int32_t k = 0; k < m/2; k++ ) {
+            int32_t a = order[k];
+            int32_t b = order[m-1-k];
+            if ( a >= n || b >= n ) continue;
+            if ( a > b ) { const int32_t t = a; a = b; b = t; }
             
-            if ( ! write_gameset( p2_in, points_p2, points_p1, score_p2, score_p1 ) ) {
-                return EXIT_FAILURE;
+            match_job *job = &jobs[number_of_pairings];
+            game_dispatcher *dispatcher = &dispatchers[number_of_pairings];
+            pthread_mutex_init( &dispatcher->mutex, NULL );
+            dispatcher->index_of_next_game = 0;   // every pairing plays the same deals.
+            snprintf( labels[number_of_pairings], k_max_line, "LEAGUE: [%d] %s vs [%d] %s", a+1, option_league[a], b+1, option_league[b] );
+            
+            memset( job, 0, sizeof( *job ) );
+            job->p1 = &players[a];
+            job->p2 = &players[b];
+            job->dispatcher = dispatcher;
+            job->label = labels[number_of_pairings];
+            job->index_of_record = index_of_pairing++ * option_number_of_games;
+            number_of_pairings++;
+        }
+        
+        for ( int32_t begin = 0; begin < number_of_pairings; begin += option_number_of_jobs ) {
+            const int32_t count = number_of_pairings - begin < option_number_of_jobs ? number_of_pairings - begin : option_number_of_jobs;
+            if ( run_jobs( jobs + begin, count ) != EXIT_SUCCESS ) exit_code = EXIT_FAILURE;
+        }
+        for ( int32_t k = 0; k < number_of_pairings; k++ ) {
+            const int32_t a = (int32_t)( jobs[k].p1 - players );
+            const int32_t b = (int32_t)( jobs[k].p2 - players );
+            table[a*n+b] += jobs[k].score_p1;
+            table[b*n+a] += jobs[k].score_p2;
+            overhead += jobs[k].overhead;
+            pthread_mutex_destroy( &dispatchers[k].mutex );
+        }
+        
+        // rotate all but the first.
+        const int32_t last = order[m-1];
+        memmove( order+2, order+1, ( m-2 ) * sizeof( int32_t ) );
+        order[1] = last;
+    }
+    log_writer_stop( &game_log_writer );
+    if ( ! replay_writer_close( &game_replay_writer ) ) exit_code = EXIT_FAILURE;
+    
+    // print cross table. a row is the points of the player against each column.
+    if ( exit_code == EXIT_SUCCESS ) {
+        fprintf( stdout, "LEAGUE\n" );
+        for ( int32_t i = 0; i < n; i++ ) {
+            fprintf( stdout, "[%d] %s\n", i+1, option_league[i] );
+        }
+        fprintf( stdout, "%6s", "" );
+        for ( int32_t j = 0; j < n; j++ ) fprintf( stdout, " %7s%d]", "[", j+1 );
+        fprintf( stdout, " %9s\n", "TOTAL" );
+        for ( int32_t i = 0; i < n; i++ ) {
+            int32_t total = 0;
+            fprintf( stdout, "[%3d]:", i+1 );
+            for ( int32_t j = 0; j < n; j++ ) {
+                if ( i == j ) {
+                    fprintf( stdout, " %9s", "-" );
+                } else {
+                    fprintf( stdout, " %9d", table[i*n+j] );
+                    total += table[i*n+j];
+                }
             }
-            if ( ! read_to_lineend( p2_out ) ) {
-                return EXIT_FAILURE;
+            fprintf( stdout, " %9d\n", total );
+        }
+        if ( option_move_time > 0 || option_clock > 0 ) {
+            for ( int32_t i = 0; i < n; i++ ) {
+                fprintf( stdout, "[%d] TIMEOUTS: %d\n", i+1, players[i].timeouts );
             }
         }
+        if ( option_latency != latency_none ) {
+            int64_t moves = 0;
+            for ( int32_t i = 0; i < n; i++ ) {
+                char name[16];
+                snprintf( name, sizeof( name ), "[%d]", i+1 );
+                print_latency( name, &players[i].latency );
+                moves += players[i].latency.count;
+            }
+            fprintf( stdout, "SERVER OVERHEAD: %.3fs %.2fus/move\n", overhead * 1e-9, moves > 0 ? overhead * 1e-3 / moves : 0.0 );
+        }
     }
     
-    return EXIT_SUCCESS;
+    if ( option_verbose ) fprintf( stderr, "ゲームを終了します...\n" );
+    for ( int32_t i = 0; i < n; i++ ) player_close( &players[i] );
+    for ( int32_t i = 0; i < n; i++ ) deal_source_free( &dispatchers[i].deals );
+    free( order );
+    free( labels );
+    free( dispatchers );
+    free( jobs );
+    free( table );
+    free( players );
+    return exit_code;
 }
 
+// Slow-Bench.c includes this file without main.
+#ifndef SLOW_SERVER_NO_MAIN
 int main( const int argc, const char *argv[] )
 {
     // get options.
+    option_seed = (uint64_t)time( NULL );
     for ( int i = 1; i < argc; i++ ) {
         if ( i+1 < argc && strcmp( argv[i], "--player1" ) == 0 ) {
             option_player1 = argv[++i];
         } else if ( i+1 < argc && strcmp( argv[i], "--player2" ) == 0 ) {
             option_player2 = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--player1-so" ) == 0 ) {
+            option_player1_so = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--player2-so" ) == 0 ) {
+            option_player2_so = argv[++i];
         } else if ( i+1 < argc && strcmp( argv[i], "--number" ) == 0 ) {
             option_number_of_games = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--jobs" ) == 0 ) {
+            option_number_of_jobs = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--sessions" ) == 0 ) {
+            option_number_of_sessions = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--batch" ) == 0 ) {
+            option_batch = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--latency" ) == 0 ) {
+            i++;
+            if ( strcmp( argv[i], "run" ) == 0 ) {
+                option_latency = latency_run;
+            } else if ( strcmp( argv[i], "game" ) == 0 ) {
+                option_latency = latency_game;
+            } else {
+                fprintf( stdout, "error: 引数 --latency には run か game を与えてください.\n" );
+                usage();
+                return EXIT_FAILURE;
+            }
+        } else if ( i+1 < argc && strcmp( argv[i], "--move-time" ) == 0 ) {
+            option_move_time = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--clock" ) == 0 ) {
+            option_clock = atoi( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--timeout" ) == 0 ) {
+            i++;
+            if ( strcmp( argv[i], "auto" ) == 0 ) {
+                option_timeout = timeout_auto;
+            } else if ( strcmp( argv[i], "forfeit" ) == 0 ) {
+                option_timeout = timeout_forfeit;
+            } else {
+                fprintf( stdout, "error: 引数 --timeout には auto か forfeit を与えてください.\n" );
+                usage();
+                return EXIT_FAILURE;
+            }
+        } else if ( i+1 < argc && strcmp( argv[i], "--transport" ) == 0 ) {
+            i++;
+            if ( strcmp( argv[i], "pipe" ) == 0 ) {
+                option_transport = transport_pipe;
+            } else if ( strcmp( argv[i], "shm" ) == 0 ) {
+                option_transport = transport_shm;
+            } else {
+                fprintf( stdout, "error: 引数 --transport には pipe か shm を与えてください.\n" );
+                usage();
+                return EXIT_FAILURE;
+            }
+        } else if ( i+1 < argc && strcmp( argv[i], "--replay" ) == 0 ) {
+            option_replay = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--deals" ) == 0 ) {
+            option_deals = argv[++i];
+        } else if ( i+1 < argc && strcmp( argv[i], "--sprt" ) == 0 ) {
+            option_sprt = atof( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--sprt-alpha" ) == 0 ) {
+            option_sprt_alpha = atof( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--sprt-beta" ) == 0 ) {
+            option_sprt_beta = atof( argv[++i] );
+        } else if ( i+1 < argc && strcmp( argv[i], "--seed" ) == 0 ) {
+            option_seed = strtoull( argv[++i], NULL, 10 );
+        } else if ( i+1 < argc && strcmp( argv[i], "--league" ) == 0 ) {
+            if ( option_number_of_league < k_max_league ) {
+                option_league[option_number_of_league++] = argv[++i];
+            } else {
+                fprintf( stdout, "error: 引数 %s をこれ以上指定できません.\n", argv[i] );
+                usage();
+                return EXIT_FAILURE;
+            }
         } else if ( i+1 < argc && strcmp( argv[i], "--arg1" ) == 0 ) {
             if ( option_number_of_arguments1 < k_max_arg ) {
                 option_arguments1[option_number_of_arguments1++] = argv[++i];
@@ -607,6 +2377,19 @@ int main( const int argc, const char *argv[] )
             return EXIT_SUCCESS;
         } else if ( strcmp( argv[i], "--verbose" ) == 0 ) {
             option_verbose = true;
+        } else if ( i+1 < argc && strcmp( argv[i], "--output" ) == 0 ) {
+            const char *level = argv[++i];
+            if ( strcmp( level, "silent" ) == 0 ) {
+                option_output = output_silent;
+            } else if ( strcmp( level, "game" ) == 0 ) {
+                option_output = output_game;
+            } else if ( strcmp( level, "turn" ) == 0 ) {
+                option_output = output_turn;
+            } else {
+                fprintf( stdout, "error: 引数 --output %s は解釈できません.\n", level );
+                usage();
+                return EXIT_FAILURE;
+            }
         } else {
             fprintf( stdout, "error: 引数 %s は解釈できません.\n", argv[i] );
             usage();
@@ -615,148 +2398,242 @@ int main( const int argc, const char *argv[] )
     }
     
     // validate options.
-    if ( ! option_player1 ) {
+    if ( option_number_of_league == 1 ) {
+        fprintf( stdout, "error: 引数 --league は2つ以上与えてください.\n" );
+        usage();
+        return EXIT_FAILURE;
+    }
+    
+    if ( ! option_player1 && ! option_player1_so && option_number_of_league == 0 ) {
         fprintf( stdout, "error: 引数 --player1 を与えてください.\n" );
         usage();
         return EXIT_FAILURE;
     }
     
-    if ( ! option_player2 ) {
+    if ( ! option_player2 && ! option_player2_so && option_number_of_league == 0 ) {
         fprintf( stdout, "error: 引数 --player2 を与えてください.\n" );
         usage();
         return EXIT_FAILURE;
     }
     
-    // print options.
-    if ( option_verbose ) {
-        fprintf( stdout, "オプション\n" );
-        fprintf( stdout, " --player1 %s\n", option_player1 );
-        fprintf( stdout, " --player2 %s\n", option_player2 );
-        fprintf( stdout, " --number %d\n", option_number_of_games );
-        fprintf( stdout, " --verbose %s\n", option_verbose ? "true" : "false" );
+    if ( option_move_time < 0 || option_clock < 0 ) {
+        fprintf( stdout, "error: 引数 --move-time, --clock には0以上を与えてください.\n" );
+        usage();
+        return EXIT_FAILURE;
     }
     
-    // srand
-    srand( time( NULL ) );
-    
-    // setup pipe.
-    if ( option_verbose ) fprintf( stderr, "パイプを準備します...\n" );
-    
-    int fd_p1_in[2];
-    int fd_p1_out[2];
-    int fd_p2_in[2];
-    int fd_p2_out[2];
-    
-    if ( pipe( fd_p1_in ) == -1 ) {
-        fprintf( stderr, "error: pipe に失敗しました(%d).\n", __LINE__ );
+    if ( option_number_of_jobs < 1 ) {
+        fprintf( stdout, "error: 引数 --jobs には1以上を与えてください.\n" );
+        usage();
         return EXIT_FAILURE;
     }
     
-    if ( pipe( fd_p1_out ) == -1 ) {
-        fprintf( stderr, "error: pipe に失敗しました(%d).\n", __LINE__ );
+    if ( option_number_of_sessions < 0 ) {
+        fprintf( stdout, "error: 引数 --sessions には0以上を与えてください. 0 は同時対戦をしません.\n" );
+        usage();
         return EXIT_FAILURE;
     }
     
-    if ( pipe( fd_p2_in ) == -1 ) {
-        fprintf( stderr, "error: pipe に失敗しました(%d).\n", __LINE__ );
+    if ( option_sprt < 0 || option_sprt_alpha <= 0 || option_sprt_alpha >= 0.5 || option_sprt_beta <= 0 || option_sprt_beta >= 0.5 ) {
+        fprintf( stdout, "error: 引数 --sprt には正の数を, --sprt-alpha と --sprt-beta には 0 から 0.5 の間の数を与えてください.\n" );
+        usage();
         return EXIT_FAILURE;
     }
     
-    if ( pipe( fd_p2_out ) == -1 ) {
-        fprintf( stderr, "error: pipe に失敗しました(%d).\n", __LINE__ );
+    // a league plays many pairings, and the test is of one.
+    if ( option_sprt > 0 && option_number_of_league > 0 ) {
+        fprintf( stdout, "error: 引数 --sprt は --league と同時に使えません.\n" );
+        usage();
         return EXIT_FAILURE;
     }
     
-    // lauch process.
-    if ( option_verbose ) fprintf( stderr, "プロセスを複製します...\n" );
+    // sessions wait on pipes, and have no deadlines yet.
+    if ( option_number_of_sessions > 0 && ( option_number_of_jobs > 1 || option_number_of_league > 0 || option_player1_so || option_player2_so || option_move_time > 0 || option_clock > 0 || option_transport != transport_pipe ) ) {
+        fprintf( stdout, "error: 引数 --sessions は --jobs, --league, --player1-so, --player2-so, --move-time, --clock, --transport shm と同時に使えません.\n" );
+        usage();
+        return EXIT_FAILURE;
+    }
     
-    pid_t pid_p1;
-    pid_t pid_p2;
+    if ( option_batch < 0 || option_batch > k_protocol_max_batch ) {
+        fprintf( stdout, "error: 引数 --batch には1から%dまでを与えてください.\n", k_protocol_max_batch );
+        usage();
+        return EXIT_FAILURE;
+    }
     
-    pid_p1 = fork();
-    if ( pid_p1 == -1 ) {
-        fprintf( stderr, "error: fork に失敗しました(%d).\n", __LINE__ );
+    // a batch waits on both players at once, and has no deadlines or latencies of a move.
+    if ( option_batch > 0 && ( option_number_of_sessions > 0 || option_number_of_league > 0 || option_player1_so || option_player2_so || option_move_time > 0 || option_clock > 0 || option_latency != latency_none ) ) {
+        fprintf( stdout, "error: 引数 --batch は --sessions, --league, --player1-so, --player2-so, --move-time, --clock, --latency と同時に使えません.\n" );
+        usage();
         return EXIT_FAILURE;
     }
     
-    if ( pid_p1 == 0 ) {
-        // player1 child process.
-        if ( option_verbose ) fprintf( stderr, "[%s]を実行します...\n", option_player1 );
-        
-        // close other pipes.
-        if ( close( fd_p2_in[0] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
-        }
-        if ( close( fd_p2_in[1] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    // print options.
+    if ( option_verbose ) {
+        fprintf( stdout, "オプション\n" );
+        fprintf( stdout, " --player1 %s\n", option_player1_so ? option_player1_so : option_player1 );
+        fprintf( stdout, " --player2 %s\n", option_player2_so ? option_player2_so : option_player2 );
+        fprintf( stdout, " --number %d\n", option_number_of_games );
+        fprintf( stdout, " --jobs %d\n", option_number_of_jobs );
+        if ( option_number_of_sessions > 0 ) fprintf( stdout, " --sessions %d\n", option_number_of_sessions );
+        if ( option_batch > 0 ) fprintf( stdout, " --batch %d\n", option_batch );
+        fprintf( stdout, " --seed %llu\n", (unsigned long long)option_seed );
+        if ( option_replay ) fprintf( stdout, " --replay %s\n", option_replay );
+        if ( option_deals ) fprintf( stdout, " --deals %s\n", option_deals );
+        if ( option_latency != latency_none ) fprintf( stdout, " --latency %s\n", option_latency == latency_run ? "run" : "game" );
+        if ( option_move_time > 0 ) fprintf( stdout, " --move-time %d\n", option_move_time );
+        if ( option_clock > 0 ) fprintf( stdout, " --clock %d\n", option_clock );
+        if ( option_move_time > 0 || option_clock > 0 ) fprintf( stdout, " --timeout %s\n", option_timeout == timeout_auto ? "auto" : "forfeit" );
+        if ( option_transport != transport_pipe ) fprintf( stdout, " --transport shm\n" );
+        if ( option_sprt > 0 ) fprintf( stdout, " --sprt %g --sprt-alpha %g --sprt-beta %g\n", option_sprt, option_sprt_alpha, option_sprt_beta );
+        for ( int32_t i = 0; i < option_number_of_league; i++ ) {
+            fprintf( stdout, " --league %s\n", option_league[i] );
         }
-        if ( close( fd_p2_out[0] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+        fprintf( stdout, " --verbose %s\n", option_verbose ? "true" : "false" );
+        fprintf( stdout, " --output %s\n", option_output == output_silent ? "silent" : option_output == output_game ? "game" : "turn" );
+    }
+    
+    // the file has to hold every game.
+    if ( option_deals ) {
+        if ( ! deal_file_read( &game_deal_file, option_deals ) ) {
+            fprintf( stderr, "error: %s を山札のファイルとして読み込めませんでした(%d).\n", option_deals, __LINE__ );
+            return EXIT_FAILURE;
         }
-        if ( close( fd_p2_out[1] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+        if ( game_deal_file.header.number_of_games < option_number_of_games ) {
+            fprintf( stdout, "error: 引数 --number には山札のファイルのゲームの数 %d 以下を与えてください.\n", game_deal_file.header.number_of_games );
+            usage();
+            return EXIT_FAILURE;
         }
-        
-        return run_player( option_player1, option_arguments1, fd_p1_in[0], fd_p1_out[1] );
     }
     
-    pid_p2 = fork();
-    if ( pid_p2 == -1 ) {
-        fprintf( stderr, "error: fork に失敗しました(%d).\n", __LINE__ );
+    // a player that exits makes write() fail instead of killing the server.
+    signal( SIGPIPE, SIG_IGN );
+    
+    if ( option_number_of_league > 0 ) {
+        const int exit_code = run_league();
+        deal_file_free( &game_deal_file );
+        return exit_code;
+    }
+    
+    // lauch players. each job has its own pair.
+    const int32_t number_of_jobs = option_number_of_sessions > 0 ? option_number_of_sessions : option_number_of_jobs;
+    if ( option_number_of_sessions > 0 ) raise_file_limit();
+    match_job *jobs = calloc( number_of_jobs, sizeof( match_job ) );
+    player *players = calloc( number_of_jobs * 2, sizeof( player ) );
+    if ( ! jobs || ! players ) {
+        fprintf( stderr, "error: calloc に失敗しました(%d).\n", __LINE__ );
         return EXIT_FAILURE;
     }
+    game_dispatcher dispatcher = { PTHREAD_MUTEX_INITIALIZER, 0, {}, NULL };
+    if ( ! dispatcher_open( &dispatcher ) ) return EXIT_FAILURE;
+    sprt_test sprt = {};
+    if ( option_sprt > 0 ) {
+        if ( ! sprt_open( &sprt, option_number_of_games ) ) return EXIT_FAILURE;
+        dispatcher.sprt = &sprt;
+    }
+    for ( int32_t i = 0; i < number_of_jobs; i++ ) {
+        jobs[i].p1 = &players[i*2];
+        jobs[i].p2 = &players[i*2+1];
+        player_init( jobs[i].p1, NULL );
+        player_init( jobs[i].p2, NULL );
+        jobs[i].dispatcher = &dispatcher;
+    }
     
-    if ( pid_p2 == 0 ) {
-        // player1 child process.
-        if ( option_verbose ) fprintf( stderr, "[%s]を実行します...\n", option_player1 );
-        
-        // close other pipes.
-        if ( close( fd_p1_in[0] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
-        }
-        if ( close( fd_p1_in[1] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
-        }
-        if ( close( fd_p1_out[0] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    bool ready = true;
+    for ( int32_t i = 0; ready && i < number_of_jobs; i++ ) {
+        if ( option_player1_so ) {
+            ready = player_load( jobs[i].p1, option_player1_so );
+        } else {
+            ready = player_launch( jobs[i].p1, option_player1, option_arguments1 );
         }
-        if ( close( fd_p1_out[1] ) == -1 ) {
-            fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+        if ( ready ) {
+            if ( option_player2_so ) {
+                ready = player_load( jobs[i].p2, option_player2_so );
+            } else {
+                ready = player_launch( jobs[i].p2, option_player2, option_arguments2 );
+            }
         }
-        
-        return run_player( option_player1, option_arguments2, fd_p2_in[0], fd_p2_out[1] );
     }
     
     // start game.
-    const int exit_code = run_game( fd_p1_in[1], fd_p1_out[0], fd_p2_in[1], fd_p2_out[0] );
-    
-    // cleanup.
-    if ( option_verbose ) fprintf( stderr, "ゲームを終了します...\n" );
-    
-    if ( close( fd_p1_in[0] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    if ( option_verbose ) fprintf( stderr, "ゲームを初期化します...\n" );
+    if ( ready && option_output > output_silent ) {
+        ready = log_writer_start( &game_log_writer );
     }
-    if ( close( fd_p1_in[1] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    if ( ready && option_replay ) {
+        ready = replay_writer_open( &game_replay_writer, option_replay, option_number_of_games );
     }
-    if ( close( fd_p1_out[0] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    int exit_code = EXIT_FAILURE;
+    if ( ready ) {
+        exit_code = option_number_of_sessions > 0 ? run_sessions( jobs, number_of_jobs ) : run_jobs( jobs, number_of_jobs );
     }
-    if ( close( fd_p1_out[1] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    log_writer_stop( &game_log_writer );
+    
+    // games are handed out in order, so the played ones are the first of the replay.
+    if ( dispatcher.sprt && game_replay_writer.file ) game_replay_writer.number_of_records = dispatcher.index_of_next_game;
+    if ( ! replay_writer_close( &game_replay_writer ) ) exit_code = EXIT_FAILURE;
+    
+    // merge scores of the jobs.
+    int32_t score_p1 = 0;
+    int32_t score_p2 = 0;
+    for ( int32_t i = 0; i < number_of_jobs; i++ ) {
+        score_p1 += jobs[i].score_p1;
+        score_p2 += jobs[i].score_p2;
     }
-    if ( close( fd_p2_in[0] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    if ( ready && ( number_of_jobs > 1 || option_output < output_turn ) ) {
+        fprintf( stdout, "P1 SCORE: %d\n", score_p1 );
+        fprintf( stdout, "P2 SCORE: %d\n", score_p2 );
     }
-    if ( close( fd_p2_in[1] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    
+    if ( ready && ( option_move_time > 0 || option_clock > 0 ) ) {
+        int32_t timeouts_p1 = 0;
+        int32_t timeouts_p2 = 0;
+        for ( int32_t i = 0; i < number_of_jobs; i++ ) {
+            timeouts_p1 += jobs[i].p1->timeouts;
+            timeouts_p2 += jobs[i].p2->timeouts;
+        }
+        fprintf( stdout, "P1 TIMEOUTS: %d\n", timeouts_p1 );
+        fprintf( stdout, "P2 TIMEOUTS: %d\n", timeouts_p2 );
     }
-    if ( close( fd_p2_out[0] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    
+    // games after the verdict may have been started by other jobs. they are played but not tested.
+    if ( ready && dispatcher.sprt ) {
+        fprintf( stdout, "SPRT GAMES: %d\n", sprt.number_of_games );
+        fprintf( stdout, "SPRT PLAYED: %d\n", sprt.number_of_ended );
+        fprintf( stdout, "SPRT SAVED: %d\n", option_number_of_games - sprt.number_of_ended );
+        fprintf( stdout, "SPRT MEAN: %.3f\n", sprt.number_of_games > 0 ? sprt.sum / sprt.number_of_games : 0.0 );
+        fprintf( stdout, "SPRT LLR: %.3f (%.3f, %.3f)\n", sprt.llr, sprt_lower_bound(), sprt_upper_bound() );
+        fprintf( stdout, "SPRT VERDICT: %s\n", k_sprt_verdict_names[sprt.verdict] );
     }
-    if ( close( fd_p2_out[1] ) == -1 ) {
-        fprintf( stderr, "warn: close に失敗しました(%d).\n", __LINE__ );
+    sprt_close( &sprt );
+    
+    // merge latencies of the jobs by side.
+    if ( ready && option_latency != latency_none ) {
+        latency_histogram *latency = calloc( 2, sizeof( latency_histogram ) );
+        int64_t overhead = 0;
+        for ( int32_t i = 0; latency && i < number_of_jobs; i++ ) {
+            latency_merge( &latency[0], &jobs[i].p1->latency );
+            latency_merge( &latency[1], &jobs[i].p2->latency );
+            overhead += jobs[i].overhead;
+        }
+        if ( latency ) {
+            const int64_t moves = latency[0].count + latency[1].count;
+            print_latency( "P1", &latency[0] );
+            print_latency( "P2", &latency[1] );
+            fprintf( stdout, "SERVER OVERHEAD: %.3fs %.2fus/move\n", overhead * 1e-9, moves > 0 ? overhead * 1e-3 / moves : 0.0 );
+        }
+        free( latency );
+    }
+    
+    // cleanup.
+    if ( option_verbose ) fprintf( stderr, "ゲームを終了します...\n" );
+    for ( int32_t i = 0; i < number_of_jobs * 2; i++ ) {
+        player_close( &players[i] );
     }
+    free( players );
+    free( jobs );
+    deal_source_free( &dispatcher.deals );
+    deal_file_free( &game_deal_file );
     
     return exit_code;
 }
+#endif
@@ -0,0 +1,201 @@
+#ifdef __linux__
+#define _GNU_SOURCE // memfd_create
+#endif
+
+#include "Slow-Shm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+static const int32_t k_shm_spin = 2000;             // polls of the ring before sleeping, when the peer has a core of its own.
+static const int64_t k_shm_sleep = 10000000;        // nanoseconds between checks of the pipe while sleeping.
+#ifndef __linux__
+static const int64_t k_shm_nap = 50000;             // nanoseconds of a nap without futex.
+#endif
+
+static int64_t shm_now( void )
+{
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// spinning only helps when the peer runs on another core at the same time.
+static int32_t shm_spin( void )
+{
+    static _Atomic int32_t spin = -1;
+    int32_t value = atomic_load_explicit( &spin, memory_order_relaxed );
+    if ( value < 0 ) {
+        value = sysconf( _SC_NPROCESSORS_ONLN ) > 1 ? k_shm_spin : 0;
+        atomic_store_explicit( &spin, value, memory_order_relaxed );
+    }
+    return value;
+}
+
+// the peer is gone when its pipe is hung up.
+static bool shm_hangup( const int fd )
+{
+    if ( fd == -1 ) return false;
+    struct pollfd fds = { fd, 0, 0 };
+    return poll( &fds, 1, 0 ) > 0 && ( fds.revents & ( POLLHUP | POLLERR | POLLNVAL ) ) != 0;
+}
+
+// sleeps while *word is value, at most nanoseconds.
+static void shm_sleep( _Atomic uint32_t *word, const uint32_t value, const int64_t nanoseconds )
+{
+#ifdef __linux__
+    // the memory is shared between processes, so the futex is not private.
+    const struct timespec timeout = { (time_t)( nanoseconds / 1000000000 ), (long)( nanoseconds % 1000000000 ) };
+    syscall( SYS_futex, (uint32_t *)word, FUTEX_WAIT, value, &timeout, NULL, 0 );
+#else
+    if ( atomic_load( word ) != value ) return;
+    const int64_t nap = nanoseconds < k_shm_nap ? nanoseconds : k_shm_nap;
+    const struct timespec timeout = { 0, (long)nap };
+    nanosleep( &timeout, NULL );
+#endif
+}
+
+static void shm_wake( _Atomic uint32_t *word )
+{
+#ifdef __linux__
+    syscall( SYS_futex, (uint32_t *)word, FUTEX_WAKE, 1, NULL, NULL, 0 );
+#else
+    (void)word;
+#endif
+}
+
+shm_channel *shm_create( int *fd )
+{
+#ifdef __linux__
+    *fd = memfd_create( "Slow-Shm", MFD_CLOEXEC );
+#else
+    // a name is needed only until the file is opened.
+    char name[64];
+    snprintf( name, sizeof( name ), "/Slow-Shm-%d-%lld", (int)getpid(), (long long)shm_now() );
+    *fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+    if ( *fd != -1 ) {
+        shm_unlink( name );
+        fcntl( *fd, F_SETFD, FD_CLOEXEC );
+    }
+#endif
+    if ( *fd == -1 ) return NULL;
+
+    shm_channel *channel = MAP_FAILED;
+    if ( ftruncate( *fd, sizeof( shm_channel ) ) == 0 ) {
+        channel = mmap( NULL, sizeof( shm_channel ), PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0 );
+    }
+    if ( channel == MAP_FAILED ) {
+        close( *fd );
+        *fd = -1;
+        return NULL;
+    }
+    // a new file is zero filled, which is an empty ring.
+    return channel;
+}
+
+shm_channel *shm_attach( void )
+{
+    const char *value = getenv( SLOW_SHM_FD );
+    if ( ! value ) return NULL;
+    const int fd = atoi( value );
+    shm_channel *channel = mmap( NULL, sizeof( shm_channel ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    return channel == MAP_FAILED ? NULL : channel;
+}
+
+void shm_detach( shm_channel *channel )
+{
+    if ( channel ) munmap( channel, sizeof( shm_channel ) );
+}
+
+bool shm_ring_write( shm_ring *ring, const void *bytes, const size_t size, const int hangup_fd )
+{
+    const uint8_t *it = bytes;
+    size_t rest = size;
+    while ( rest > 0 ) {
+        const uint32_t head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+        const uint32_t tail = atomic_load_explicit( &ring->tail, memory_order_acquire );
+        size_t space = k_shm_ring_size - ( head - tail );
+        if ( space == 0 ) {
+            // frames are small, so a full ring means the reader is stuck.
+            if ( shm_hangup( hangup_fd ) ) return false;
+            sched_yield();
+            continue;
+        }
+        if ( space > rest ) space = rest;
+
+        // copy in up to two pieces around the end of the data.
+        const size_t offset = head & ( k_shm_ring_size - 1 );
+        const size_t first = space < k_shm_ring_size - offset ? space : k_shm_ring_size - offset;
+        memcpy( ring->data + offset, it, first );
+        memcpy( ring->data, it + first, space - first );
+        it += space;
+        rest -= space;
+
+        // the reader sets sleeping before it checks head, so one of the two sees the other.
+        atomic_store_explicit( &ring->head, head + (uint32_t)space, memory_order_seq_cst );
+        if ( atomic_load_explicit( &ring->sleeping, memory_order_seq_cst ) ) shm_wake( &ring->head );
+    }
+    return true;
+}
+
+int32_t shm_ring_read( shm_ring *ring, void *bytes, const size_t size, const int64_t deadline, const int hangup_fd )
+{
+    const uint32_t tail = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+    uint32_t head = atomic_load_explicit( &ring->head, memory_order_acquire );
+
+    // spin a little first. a fast peer answers before a sleep would even start.
+    const int32_t spin = shm_spin();
+    for ( int32_t i = 0; head == tail && i < spin; i++ ) {
+        head = atomic_load_explicit( &ring->head, memory_order_acquire );
+    }
+    while ( head == tail ) {
+        if ( atomic_load_explicit( &ring->closed, memory_order_acquire ) ) {
+            // bytes written before closing are still read.
+            head = atomic_load_explicit( &ring->head, memory_order_acquire );
+            if ( head == tail ) return 0;
+            break;
+        }
+        int64_t nanoseconds = k_shm_sleep;
+        if ( deadline != 0 ) {
+            const int64_t rest = deadline - shm_now();
+            if ( rest <= 0 ) return -1;
+            if ( rest < nanoseconds ) nanoseconds = rest;
+        }
+        atomic_store_explicit( &ring->sleeping, 1, memory_order_seq_cst );
+        if ( atomic_load_explicit( &ring->head, memory_order_seq_cst ) == tail ) {
+            shm_sleep( &ring->head, tail, nanoseconds );
+        }
+        atomic_store_explicit( &ring->sleeping, 0, memory_order_relaxed );
+        head = atomic_load_explicit( &ring->head, memory_order_acquire );
+        if ( head == tail && shm_hangup( hangup_fd ) ) return 0;
+    }
+
+    size_t available = head - tail;
+    if ( available > size ) available = size;
+    const size_t offset = tail & ( k_shm_ring_size - 1 );
+    const size_t first = available < k_shm_ring_size - offset ? available : k_shm_ring_size - offset;
+    memcpy( bytes, ring->data + offset, first );
+    memcpy( (uint8_t *)bytes + first, ring->data, available - first );
+    atomic_store_explicit( &ring->tail, tail + (uint32_t)available, memory_order_release );
+    return (int32_t)available;
+}
+
+void shm_ring_close( shm_ring *ring )
+{
+    atomic_store_explicit( &ring->closed, 1, memory_order_seq_cst );
+    // a reader about to sleep still sees closed within k_shm_sleep.
+    if ( atomic_load_explicit( &ring->sleeping, memory_order_seq_cst ) ) shm_wake( &ring->head );
+}
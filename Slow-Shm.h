@@ -0,0 +1,81 @@
+#ifndef SLOW_SHM_H
+#define SLOW_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+//!
+//! サーバーとプレイヤーの間で共有メモリを使って通信するためのリングバッファです.
+//!
+//! サーバーは --transport shm で共有メモリを作り, そのファイル記述子の番号を環境変数 SLOW_SHM_FD でプレイヤーに渡します.
+//! プレイヤーが最初の RESET に空行の代わりに "SHM" を返すと, それ以降のメッセージは Slow-Protocol.h のバイナリのフレームで
+//! 共有メモリの2つのリングを通ります. 返さなければパイプのまま続けます.
+//!
+//! リングは書き手と読み手が1つずつで, 読み手は少しの間だけ回って待ち, それでも来なければ眠ります.
+//! Linux では futex で眠り, 書き手は読み手が眠っている場合だけ起こします. それ以外の環境では短く眠りながら待ちます.
+//! パイプは閉じずに残し, 相手のプロセスが終わったことはパイプが切れたことで知ります.
+//!
+
+#define SLOW_PROTOCOL_SHM "SHM"         //!< 共有メモリを選ぶ RESET への返答
+#define SLOW_SHM_FD "SLOW_SHM_FD"       //!< 共有メモリのファイル記述子を渡す環境変数
+
+static const size_t k_shm_ring_size = 4096;     //!< リングのバイト数. 2の冪.
+
+//! 書き手と読み手が1つずつのリング. 添字は折り返さずに数え続ける.
+typedef struct {
+    _Alignas(64) _Atomic uint32_t head;     //!< 書き手が書き終えた位置. futex で待つ値でもある.
+    _Atomic uint32_t sleeping;              //!< 読み手が眠っている
+    _Atomic uint32_t closed;                //!< 書き手がこれ以上書かない
+    _Alignas(64) _Atomic uint32_t tail;     //!< 読み手が読み終えた位置
+    _Alignas(64) uint8_t data[k_shm_ring_size];
+} shm_ring;
+
+//! 共有メモリの全体
+typedef struct {
+    shm_ring to_player;
+    shm_ring to_server;
+} shm_channel;
+
+//!
+//! @brief  共有メモリを作ります
+//!
+//! @param  fd  [out]共有メモリのファイル記述子. close-on-exec なので, 渡す子プロセスでは外してください.
+//!
+//! @return 失敗すると NULL
+//!
+shm_channel *shm_create( int *fd );
+
+//!
+//! @brief  環境変数 SLOW_SHM_FD で渡された共有メモリを開きます
+//!
+//! @return 渡されていないか失敗すると NULL
+//!
+shm_channel *shm_attach( void );
+
+void shm_detach( shm_channel *channel );
+
+//!
+//! @brief  リングに書きます. 空きが無ければ読まれるまで待ちます.
+//!
+//! @param  hangup_fd   [in]相手につながるパイプ. 待っている間に切れたら諦める.
+//!
+//! @retval false   相手がいなくなった
+//!
+bool shm_ring_write( shm_ring *ring, const void *bytes, const size_t size, const int hangup_fd );
+
+//!
+//! @brief  リングから読めるだけ読みます. 何も無ければ来るまで待ちます.
+//!
+//! @param  deadline    [in]CLOCK_MONOTONIC のナノ秒で待つ期限. 0 は期限なし.
+//! @param  hangup_fd   [in]相手につながるパイプ. 待っている間に切れたら諦める.
+//!
+//! @return 読んだバイト数. 書き手が閉じたか相手がいなくなると 0, 期限を過ぎると -1.
+//!
+int32_t shm_ring_read( shm_ring *ring, void *bytes, const size_t size, const int64_t deadline, const int hangup_fd );
+
+//! これ以上書かないことを読み手に知らせます
+void shm_ring_close( shm_ring *ring );
+
+#endif
@@ -0,0 +1,270 @@
+#include "Slow-Solver.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// a position in the solver. decks are counts by rank since their order is unknown.
+typedef struct {
+    int8_t hands[2][k_number_of_ranks+1];
+    int8_t deck[2][k_number_of_ranks+1];
+    uint16_t mask[2];           // ranks in hands.
+    int32_t number_of_hands[2];
+    int32_t number_of_deck[2];
+    int32_t sum[2];
+    int16_t top[2];             // left and right.
+    bool passed[2];             // the previous action was a pass.
+    int32_t turn;               // player to move.
+    uint64_t key;
+} solver_position;
+
+// what the value of an entry is.
+typedef enum {
+    solver_bound_exact = 0,
+    solver_bound_lower,     // the value is at least this.
+    solver_bound_upper      // the value is at most this.
+} solver_bound;
+
+typedef struct {
+    uint64_t key;           // 0 is empty.
+    double value;
+    play_action best;       // tried first when the position is searched again.
+    int8_t bound;
+} solver_entry;
+
+static const double k_solver_infinity = 1e9;
+
+struct solver_table {
+    solver_entry *entries;
+    uint64_t mask;
+    int64_t nodes;
+    // zobrist keys.
+    uint64_t key_hands[2][k_number_of_ranks+1][3];
+    uint64_t key_deck[2][k_number_of_ranks+1][3];
+    uint64_t key_tops[k_number_of_ranks+1][k_number_of_ranks+1];  // by the lower and the higher top.
+    uint64_t key_passed[2];
+    uint64_t key_turn;
+};
+
+static uint64_t random_key( game_random *random )
+{
+    return ( (uint64_t)game_random_next( random ) << 32 ) | game_random_next( random );
+}
+
+solver_table *solver_create( const int32_t table_bits )
+{
+    solver_table *table = calloc( 1, sizeof( solver_table ) );
+    if ( ! table ) return NULL;
+    // clear the entries here so the pages are not first touched during a solve.
+    const size_t size = ( (size_t)1 << table_bits ) * sizeof( solver_entry );
+    table->entries = malloc( size );
+    if ( ! table->entries ) {
+        free( table );
+        return NULL;
+    }
+    memset( table->entries, 0, size );
+    table->mask = ( (uint64_t)1 << table_bits ) - 1;
+
+    // fixed keys, so a table gives the same values in every run.
+    game_random random;
+    game_random_seed( &random, 0x51d0e5u );
+    for ( int32_t i = 0; i < 2; i++ ) {
+        for ( int32_t rank = 0; rank <= k_number_of_ranks; rank++ ) {
+            for ( int32_t count = 0; count < 3; count++ ) {
+                table->key_hands[i][rank][count] = random_key( &random );
+                table->key_deck[i][rank][count] = random_key( &random );
+            }
+        }
+        table->key_passed[i] = random_key( &random );
+    }
+    for ( int32_t low = 0; low <= k_number_of_ranks; low++ ) {
+        for ( int32_t high = low; high <= k_number_of_ranks; high++ ) {
+            table->key_tops[low][high] = random_key( &random );
+        }
+    }
+    table->key_turn = random_key( &random );
+    return table;
+}
+
+void solver_destroy( solver_table *table )
+{
+    if ( ! table ) return;
+    free( table->entries );
+    free( table );
+}
+
+// the two places are the same, so swapping the tops gives the same key.
+static uint64_t tops_key( const solver_table *table, const int16_t *top )
+{
+    return top[0] <= top[1] ? table->key_tops[top[0]][top[1]] : table->key_tops[top[1]][top[0]];
+}
+
+static uint64_t position_key( const solver_table *table, const solver_position *position )
+{
+    uint64_t key = tops_key( table, position->top ) ^ ( position->turn ? table->key_turn : 0 );
+    for ( int32_t i = 0; i < 2; i++ ) {
+        for ( int32_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+            key ^= table->key_hands[i][rank][position->hands[i][rank]];
+            key ^= table->key_deck[i][rank][position->deck[i][rank]];
+        }
+        if ( position->passed[i] ) key ^= table->key_passed[i];
+    }
+    return key ? key : 1;
+}
+
+// the moves below update the key by the parts they change.
+static void position_draw( const solver_table *table, solver_position *position, const int16_t rank )
+{
+    const int32_t i = position->turn;
+    position->key ^= table->key_deck[i][rank][position->deck[i][rank]] ^ table->key_hands[i][rank][position->hands[i][rank]];
+    position->deck[i][rank]--;
+    position->hands[i][rank]++;
+    position->key ^= table->key_deck[i][rank][position->deck[i][rank]] ^ table->key_hands[i][rank][position->hands[i][rank]];
+    position->mask[i] |= (uint16_t)( 1u << rank );
+    position->number_of_deck[i]--;
+    position->number_of_hands[i]++;
+}
+
+static void position_put( const solver_table *table, solver_position *position, const int32_t side, const int16_t rank )
+{
+    const int32_t i = position->turn;
+    position->key ^= table->key_hands[i][rank][position->hands[i][rank]] ^ tops_key( table, position->top );
+    if ( --position->hands[i][rank] == 0 ) position->mask[i] &= (uint16_t)~( 1u << rank );
+    position->top[side] = rank;
+    position->key ^= table->key_hands[i][rank][position->hands[i][rank]] ^ tops_key( table, position->top );
+    position->number_of_hands[i]--;
+    position->sum[i] -= rank;
+}
+
+static void position_next( const solver_table *table, solver_position *position, const bool passed )
+{
+    const int32_t i = position->turn;
+    if ( position->passed[i] != passed ) position->key ^= table->key_passed[i];
+    position->passed[i] = passed;
+    position->turn = 1 - i;
+    position->key ^= table->key_turn;
+    if ( position->key == 0 ) position->key = 1;
+}
+
+static double solve( solver_table *table, const solver_position *position, double alpha, const double beta, play_action *best );
+
+// value of an action for the player who takes it.
+static double solve_action( solver_table *table, const solver_position *position, const play_action action, const double alpha, const double beta )
+{
+    solver_position next = *position;
+    if ( action.operation == play_operation_draw ) {
+        // chance: each card left in the deck comes with its share. the children are searched without bounds.
+        const int32_t i = position->turn;
+        double value = 0;
+        for ( int16_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+            if ( position->deck[i][rank] == 0 ) continue;
+            next = *position;
+            position_draw( table, &next, rank );
+            position_next( table, &next, false );
+            value -= solve( table, &next, -k_solver_infinity, k_solver_infinity, NULL ) * position->deck[i][rank];
+        }
+        return value / position->number_of_deck[i];
+    }
+    if ( action.operation == play_operation_put_left || action.operation == play_operation_put_right ) {
+        position_put( table, &next, action.operation == play_operation_put_left ? 0 : 1, action.card );
+    }
+    position_next( table, &next, action.operation == play_operation_pass );
+    return -solve( table, &next, -beta, -alpha, NULL );
+}
+
+// value for the player to move, searched by negamax with alpha-beta between the chance nodes.
+static double solve( solver_table *table, const solver_position *position, double alpha, const double beta, play_action *best )
+{
+    table->nodes++;
+    const int32_t i = position->turn;
+    if ( position->sum[0] == 0 || position->sum[1] == 0 ) {
+        // same as game_points.
+        int32_t points = 0;
+        if ( position->sum[i] == 0 ) points += position->sum[1-i];
+        if ( position->sum[1-i] == 0 ) points -= position->sum[i];
+        return points;
+    }
+
+    solver_entry *entry = &table->entries[position->key & table->mask];
+    play_action first = play_action_make( play_operation_null, 0 );
+    if ( entry->key == position->key ) {
+        if ( ! best ) {
+            if ( entry->bound == solver_bound_exact ) return entry->value;
+            if ( entry->bound == solver_bound_lower && entry->value >= beta ) return entry->value;
+            if ( entry->bound == solver_bound_upper && entry->value <= alpha ) return entry->value;
+        }
+        first = entry->best;
+    }
+
+    play_action candidates[play_action_candidate_max];
+    const play_action previous = play_action_make( position->passed[i] ? play_operation_pass : play_operation_null, 0 );
+    const bool can_draw = position->number_of_hands[i] < k_max_hands && position->number_of_deck[i] > 0;
+    const int32_t number_of_candidates = play_action_candidates_mask( candidates, previous, position->mask[i], position->hands[i], can_draw, position->top[0], position->top[1] );
+    // the best action of the last search comes first. the entry may be of the position with the tops swapped.
+    for ( int32_t n = 1; n < number_of_candidates; n++ ) {
+        if ( is_equals_play_action( candidates[n], first ) ) {
+            candidates[n] = candidates[0];
+            candidates[0] = first;
+            break;
+        }
+    }
+
+    const double alpha_begin = alpha;
+    double value = -k_solver_infinity;
+    play_action value_action = candidates[0];
+    for ( int32_t n = 0; n < number_of_candidates; n++ ) {
+        // a rank held twice gives the same action twice, and the same tops give the same action on both sides.
+        const play_action action = candidates[n];
+        if ( action.operation == play_operation_put_right && position->top[0] == position->top[1] ) continue;
+        bool seen = false;
+        for ( int32_t m = 0; m < n && ! seen; m++ ) seen = is_equals_play_action( action, candidates[m] );
+        if ( seen ) continue;
+        const double action_value = solve_action( table, position, action, alpha, beta );
+        if ( action_value > value ) {
+            value = action_value;
+            value_action = action;
+            if ( value > alpha ) alpha = value;
+            if ( alpha >= beta ) break;
+        }
+    }
+    if ( best ) *best = value_action;
+
+    entry->key = position->key;
+    entry->value = value;
+    entry->best = value_action;
+    entry->bound = value <= alpha_begin ? solver_bound_upper : value >= beta ? solver_bound_lower : solver_bound_exact;
+    return value;
+}
+
+bool solver_solve( solver_table *table, const int16_t *hands_you, const int16_t *hands_op, const int8_t unseen[2][k_number_of_ranks+1], const int16_t top_left, const int16_t top_right, const play_action previous[2], solver_result *result )
+{
+    solver_position position;
+    memset( &position, 0, sizeof( position ) );
+    const int16_t *hands[2] = { hands_you, hands_op };
+    int32_t number_of_unseen = 0;
+    for ( int32_t i = 0; i < 2; i++ ) {
+        for ( const int16_t *it = hands[i]; *it != 0; it++ ) {
+            position.hands[i][*it]++;
+            position.mask[i] |= (uint16_t)( 1u << *it );
+            position.number_of_hands[i]++;
+            position.sum[i] += *it;
+        }
+        for ( int16_t rank = 1; rank <= k_number_of_ranks; rank++ ) {
+            position.deck[i][rank] = unseen[i][rank] > 0 ? unseen[i][rank] : 0;
+            position.number_of_deck[i] += position.deck[i][rank];
+            position.sum[i] += rank * position.deck[i][rank];
+        }
+        position.passed[i] = previous[i].operation == play_operation_pass;
+        number_of_unseen += position.number_of_deck[i];
+    }
+    if ( number_of_unseen > k_solver_max_unseen ) return false;
+    position.top[0] = top_left;
+    position.top[1] = top_right;
+    position.turn = 0;
+    position.key = position_key( table, &position );
+
+    const int64_t nodes = table->nodes;
+    result->action = play_action_make( play_operation_pass, 0 );
+    result->value = solve( table, &position, -k_solver_infinity, k_solver_infinity, &result->action );
+    result->nodes = table->nodes - nodes;
+    return true;
+}